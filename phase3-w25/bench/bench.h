@@ -0,0 +1,57 @@
+/* bench.h */
+// Timing and program generation shared by the microbenchmarks. Each bench
+// is a single file, so everything here is static inline.
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static inline double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Writes group `i` of a generated program to `out` and returns the number
+// of bytes written. `arg` is passed through from generate_program().
+typedef int (*GroupWriter)(char* out, int i, const void* arg);
+
+// Source made of `header` (may be NULL) followed by `groups` groups, each
+// at most `group_bytes` long. *length gets its length if length is not
+// NULL. Returns NULL if memory runs out.
+static inline char* generate_program(int groups, int group_bytes, const char* header,
+                                     GroupWriter write, const void* arg, int* length) {
+    size_t capacity = (size_t)groups * group_bytes + 64;
+    char* source = malloc(capacity);
+    if (!source) {
+        return NULL;
+    }
+    size_t used = header ? (size_t)sprintf(source, "%s", header) : 0;
+    source[used] = '\0';
+    for (int i = 0; i < groups; i++) {
+        used += write(source + used, i, arg);
+    }
+    if (length) {
+        *length = (int)used;
+    }
+    return source;
+}
+
+// The group most benches use: a declaration of v<i>, an assignment and a
+// while loop holding an if statement, at most 160 bytes. With `halve` the
+// assignment also subtracts v<i> / 2; without `semicolon` it is missing
+// its semicolon.
+static inline int nested_group(char* out, int i, int halve, int semicolon) {
+    char tail[32] = "";
+    if (halve) {
+        sprintf(tail, " - v%d / 2", i);
+    }
+    return sprintf(out,
+                   "int v%d;\nv%d = %d * 3 + 4%s%s\n"
+                   "while (v%d < 100) {\n  if (v%d > 5) {\n    v%d = v%d - 1;\n  }\n  print v%d;\n}\n",
+                   i, i, i % 97, tail, semicolon ? ";" : "", i, i, i, i, i);
+}
+
+#endif /* BENCH_H */
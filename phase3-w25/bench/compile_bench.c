@@ -0,0 +1,85 @@
+/* compile_bench.c */
+// Compares the tree pipeline (parse, analyze_semantics, free_parse_result)
+// with compiling the same program to bytecode in one pass, on a generated
+// program of nested blocks, then times running the bytecode.
+//
+//   gcc -O2 -o compile_bench bench/compile_bench.c src/lexer/*.c src/parser/*.c src/semantic/semantic.c src/bytecode/*.c -pthread
+//   ./compile_bench [statements] [runs]
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/parser.h"
+#include "../include/semantic.h"
+#include "../include/bytecode.h"
+#include "bench.h"
+
+// A declaration, an assignment and a while loop holding an if statement,
+// which stops once the variable passes 100
+static int write_group(char* out, int i, const void* arg) {
+    (void)arg;
+    return sprintf(out,
+                   "int v%d;\nv%d = %d * 3 + 4;\n"
+                   "while (v%d < 100) {\n  if (v%d > 90) {\n    print v%d;\n  }\n  v%d = v%d + 7;\n}\n",
+                   i, i, i % 97, i, i, i, i, i);
+}
+
+static char* make_program(int statements) {
+    return generate_program(statements, 160, NULL, write_group, NULL, NULL);
+}
+
+int main(int argc, char** argv) {
+    int statements = argc > 1 ? atoi(argv[1]) : 5000;
+    int runs = argc > 2 ? atoi(argv[2]) : 5;
+
+    char* source = make_program(statements);
+    FILE* sink = fopen("/dev/null", "w");
+    if (!source || !sink) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    double best_tree = 1e9, best_compile = 1e9, best_run = 1e9;
+    int tokens = 0, words = 0;
+    for (int r = 0; r < runs; r++) {
+        double t0 = now();
+        Parser parser;
+        if (!parser_init(&parser, source)) {
+            printf("out of memory\n");
+            return 1;
+        }
+        tokens = parser.tokens->count;
+        ParseResult parsed = parse(&parser);
+        if (!parsed.ast || !analyze_semantics(parsed.ast)) {
+            printf("tree pipeline failed\n");
+            return 1;
+        }
+        free_parse_result(&parsed);
+        double t1 = now();
+        CompileResult compiled = compile_program(source);
+        double t2 = now();
+        if (!compile_ok(&compiled)) {
+            print_compile_diagnostics(&compiled);
+            return 1;
+        }
+        words = compiled.program.count;
+        double t3 = now();
+        if (!run_bytecode(&compiled.program, sink)) {
+            return 1;
+        }
+        double t4 = now();
+        free_compile_result(&compiled);
+
+        if (t1 - t0 < best_tree) best_tree = t1 - t0;
+        if (t2 - t1 < best_compile) best_compile = t2 - t1;
+        if (t4 - t3 < best_run) best_run = t4 - t3;
+    }
+
+    printf("%d tokens, %d bytecode words\n", tokens, words);
+    printf("parse + analyze + free: %8.3f ms (%.2f ns/token)\n", best_tree * 1e3,
+           best_tree * 1e9 / tokens);
+    printf("one-pass compile:       %8.3f ms (%.2f ns/token), %.2fx faster\n",
+           best_compile * 1e3, best_compile * 1e9 / tokens, best_tree / best_compile);
+    printf("run bytecode:           %8.3f ms\n", best_run * 1e3);
+    fclose(sink);
+    free(source);
+    return 0;
+}
@@ -0,0 +1,124 @@
+/* expr_bench.c */
+// Microbenchmark for operator handling in the expression parser.
+//
+// Builds an expression-heavy program, then times
+//   1. resolving the precedence of every operator token, once with the
+//      operator-kind table the parser uses and once with the lexeme
+//      comparisons it used before tokens carried an operator kind, and
+//   2. a full parse of the program.
+//
+//   gcc -O2 -o expr_bench bench/expr_bench.c src/lexer/*.c src/parser/*.c -pthread
+//   ./expr_bench [statements] [runs]
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/parser.h"
+#include "../include/lexer.h"
+#include "bench.h"
+
+// Same values as operator_table in parser.c
+static const int kind_precedence[OP_KIND_COUNT] = {-1, 2, 2, 3, 3, 1, 1, 1, 1, 1};
+
+static int precedence_by_kind(const TokenStream* tokens, int i) {
+    TokenType type = (TokenType)tokens->types[i];
+    if (type != TOKEN_OPERATOR && type != TOKEN_COMPARE)
+        return -1;
+    return kind_precedence[tokens->ops[i]];
+}
+
+// The string comparisons get_precedence() used to do on every operator
+static int precedence_by_lexeme(const char* source, const TokenStream* tokens, int i) {
+    Token token = token_at(tokens, i);
+    if ((token.type != TOKEN_OPERATOR) && (token.type != TOKEN_COMPARE))
+        return -1;
+    if (token_lexeme_equals(source, token, "==") || token_lexeme_equals(source, token, "!=") ||
+        token_lexeme_equals(source, token, "<") || token_lexeme_equals(source, token, ">") ||
+        token_lexeme_equals(source, token, "<=") || token_lexeme_equals(source, token, ">="))
+        return 1;
+    if (token_lexeme_equals(source, token, "+") || token_lexeme_equals(source, token, "-"))
+        return 2;
+    if (token_lexeme_equals(source, token, "*") || token_lexeme_equals(source, token, "/"))
+        return 3;
+    return -1;
+}
+
+// An assignment whose right-hand side chains 16 operators
+static int write_group(char* out, int i, const void* arg) {
+    static const char* ops[] = {"+", "-", "*", "/", "<", "<=", ">", ">=", "=="};
+    (void)arg;
+    int length = sprintf(out, "a = b");
+    for (int k = 0; k < 16; k++) {
+        length += sprintf(out + length, " %s %c", ops[(i + k * 7) % 9], k % 3 ? 'a' : 'b');
+    }
+    return length + sprintf(out + length, ";\n");
+}
+
+static char* make_program(int statements) {
+    return generate_program(statements, 128, "int a;\nint b;\na = 1;\nb = 2;\n", write_group,
+                            NULL, NULL);
+}
+
+int main(int argc, char** argv) {
+    int statements = argc > 1 ? atoi(argv[1]) : 100000;
+    int runs = argc > 2 ? atoi(argv[2]) : 5;
+
+    char* source = make_program(statements);
+    TokenStream* tokens = source ? tokenize_all(source) : NULL;
+    if (!tokens) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    int operators = 0;
+    for (int i = 0; i < tokens->count; i++) {
+        operators += precedence_by_kind(tokens, i) >= 0;
+    }
+    printf("%d statements, %d tokens, %d operators\n", statements, tokens->count, operators);
+
+    // Precedence lookups only; the checksums keep the loops from being
+    // optimized away
+    double best_kind = 1e9, best_lexeme = 1e9;
+    long sum_kind = 0, sum_lexeme = 0;
+    for (int r = 0; r < runs; r++) {
+        double t0 = now();
+        for (int i = 0; i < tokens->count; i++) {
+            sum_kind += precedence_by_kind(tokens, i);
+        }
+        double t1 = now();
+        for (int i = 0; i < tokens->count; i++) {
+            sum_lexeme += precedence_by_lexeme(source, tokens, i);
+        }
+        double t2 = now();
+        if (t1 - t0 < best_kind) best_kind = t1 - t0;
+        if (t2 - t1 < best_lexeme) best_lexeme = t2 - t1;
+    }
+    if (sum_kind != sum_lexeme) {
+        printf("precedence mismatch: %ld vs %ld\n", sum_kind, sum_lexeme);
+        return 1;
+    }
+    printf("precedence by kind:   %8.3f ms (%.2f ns/token)\n",
+           best_kind * 1e3, best_kind * 1e9 / tokens->count);
+    printf("precedence by lexeme: %8.3f ms (%.2f ns/token), %.1fx slower\n",
+           best_lexeme * 1e3, best_lexeme * 1e9 / tokens->count, best_lexeme / best_kind);
+
+    // Full parses over the same token stream
+    double best_parse = 1e9;
+    for (int r = 0; r < runs; r++) {
+        Parser parser;
+        parser_init_tokens(&parser, source, tokens);
+        double t0 = now();
+        ParseResult result = parse(&parser);
+        double t1 = now();
+        if (result.diagnostic_count || !result.ast) {
+            print_parse_diagnostics(&result);
+            return 1;
+        }
+        free_parse_result(&result);
+        if (t1 - t0 < best_parse) best_parse = t1 - t0;
+    }
+    printf("parse:                %8.3f ms (%.2f ns/token)\n",
+           best_parse * 1e3, best_parse * 1e9 / tokens->count);
+
+    free_token_stream(tokens);
+    free(source);
+    return 0;
+}
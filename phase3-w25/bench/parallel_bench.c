@@ -0,0 +1,82 @@
+/* parallel_bench.c */
+// Parse time of one large generated program with parse() and with
+// parse_parallel() on a growing number of threads, over the same token
+// stream. Checks that every parallel parse builds the same tree.
+//
+//   gcc -O2 -o parallel_bench bench/parallel_bench.c src/lexer/*.c src/parser/*.c -pthread
+//   ./parallel_bench [statements] [runs] [max threads]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/parser.h"
+#include "../include/lexer.h"
+#include "bench.h"
+
+static int write_group(char* out, int i, const void* arg) {
+    (void)arg;
+    return nested_group(out, i, 1, 1);
+}
+
+static char* make_program(int statements) {
+    return generate_program(statements, 160, NULL, write_group, NULL, NULL);
+}
+
+static int same_tree(const AST* a, const AST* b) {
+    return a->count == b->count && a->list_count == b->list_count &&
+           memcmp(a->kinds, b->kinds, a->count) == 0 &&
+           memcmp(a->tokens, b->tokens, a->count * sizeof(int)) == 0 &&
+           memcmp(a->ends, b->ends, a->count * sizeof(int)) == 0 &&
+           memcmp(a->left, b->left, a->count * sizeof(NodeId)) == 0 &&
+           memcmp(a->right, b->right, a->count * sizeof(NodeId)) == 0 &&
+           memcmp(a->lists, b->lists, a->list_count * sizeof(NodeId)) == 0;
+}
+
+int main(int argc, char** argv) {
+    int statements = argc > 1 ? atoi(argv[1]) : 200000;
+    int runs = argc > 2 ? atoi(argv[2]) : 5;
+    int max_threads = argc > 3 ? atoi(argv[3]) : 8;
+
+    char* source = make_program(statements);
+    TokenStream* tokens = source ? tokenize_all(source) : NULL;
+    if (!tokens) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    Parser parser;
+    parser_init_tokens(&parser, source, tokens);
+    ParseResult reference = parse(&parser);
+    if (!reference.ast) {
+        printf("out of memory\n");
+        return 1;
+    }
+    printf("%d tokens, %d nodes\n", tokens->count, reference.ast->count);
+
+    double serial = 0;
+    for (int threads = 0; threads <= max_threads; threads = threads ? threads * 2 : 1) {
+        double best = 1e9;
+        for (int r = 0; r < runs; r++) {
+            parser_init_tokens(&parser, source, tokens);
+            double t0 = now();
+            ParseResult result = threads ? parse_parallel(&parser, threads) : parse(&parser);
+            double t1 = now();
+            if (!result.ast || !same_tree(result.ast, reference.ast)) {
+                printf("%d threads: tree differs from parse()\n", threads);
+                return 1;
+            }
+            free_parse_result(&result);
+            if (t1 - t0 < best) best = t1 - t0;
+        }
+        if (threads == 0) {
+            serial = best;
+            printf("parse:                 %8.3f ms\n", best * 1e3);
+        } else {
+            printf("parse_parallel(%2d):    %8.3f ms, %.2fx\n", threads, best * 1e3, serial / best);
+        }
+    }
+
+    free_parse_result(&reference);
+    free_token_stream(tokens);
+    free(source);
+    return 0;
+}
@@ -0,0 +1,68 @@
+/* pipeline_bench.c */
+// Front-end wall-clock time on one large generated program: lexing the
+// whole input and then parsing it, against parser_init_pipelined(), where
+// a lexer thread feeds the parser through a token ring.
+//
+//   gcc -O2 -o pipeline_bench bench/pipeline_bench.c src/lexer/*.c src/parser/*.c -pthread
+//   ./pipeline_bench [statements] [runs]
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/parser.h"
+#include "../include/lexer.h"
+#include "bench.h"
+
+static int write_group(char* out, int i, const void* arg) {
+    (void)arg;
+    return nested_group(out, i, 1, 1);
+}
+
+static char* make_program(int statements) {
+    return generate_program(statements, 160, NULL, write_group, NULL, NULL);
+}
+
+// Best time of `runs` front-end passes; *nodes gets the node count
+static double run(const char* source, int pipelined, int runs, int* nodes) {
+    double best = 1e9;
+    for (int r = 0; r < runs; r++) {
+        Parser parser;
+        double t0 = now();
+        int ok = pipelined ? parser_init_pipelined(&parser, source) : parser_init(&parser, source);
+        if (!ok) {
+            printf("out of memory\n");
+            exit(1);
+        }
+        ParseResult result = parse(&parser);
+        double t1 = now();
+        if (!result.ast || result.diagnostic_count) {
+            printf("parse failed\n");
+            exit(1);
+        }
+        *nodes = result.ast->count;
+        free_parse_result(&result);
+        if (t1 - t0 < best) best = t1 - t0;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int statements = argc > 1 ? atoi(argv[1]) : 200000;
+    int runs = argc > 2 ? atoi(argv[2]) : 5;
+
+    char* source = make_program(statements);
+    if (!source) {
+        printf("out of memory\n");
+        return 1;
+    }
+    int serial_nodes, pipelined_nodes;
+    double serial = run(source, 0, runs, &serial_nodes);
+    double pipelined = run(source, 1, runs, &pipelined_nodes);
+    if (serial_nodes != pipelined_nodes) {
+        printf("pipelined parse built %d nodes instead of %d\n", pipelined_nodes, serial_nodes);
+        return 1;
+    }
+    printf("%d nodes\n", serial_nodes);
+    printf("lex, then parse: %8.3f ms\n", serial * 1e3);
+    printf("pipelined:       %8.3f ms, %.2fx faster\n", pipelined * 1e3, serial / pipelined);
+    free(source);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/* push_bench.c */
+// Feeds a generated program to the push parser in fixed-size chunks, as
+// if it arrived over a pipe, and compares the total time with buffering
+// the whole input and calling parse(). Also reports how far into the
+// input the first statement and the first diagnostic were reported.
+//
+//   gcc -O2 -o push_bench bench/push_bench.c src/lexer/*.c src/parser/*.c -pthread
+//   ./push_bench [statements] [chunk bytes]
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/parser.h"
+#include "../include/lexer.h"
+#include "bench.h"
+
+// The assignment of group statements / 10 is missing its semicolon
+static int write_group(char* out, int i, const void* arg) {
+    int statements = *(const int*)arg;
+    return nested_group(out, i, 0, i != statements / 10);
+}
+
+static char* make_program(int statements, int* length) {
+    return generate_program(statements, 160, NULL, write_group, &statements, length);
+}
+
+typedef struct {
+    int statements;
+    int first_statement;        // Bytes fed when these were reported
+    int first_diagnostic;
+    const int* fed;
+} Progress;
+
+static void on_statement(void* user, const PushedStatement* statement) {
+    Progress* progress = user;
+    if (progress->statements++ == 0) {
+        progress->first_statement = *progress->fed;
+    }
+    if (statement->diagnostic_count && progress->first_diagnostic < 0) {
+        progress->first_diagnostic = *progress->fed;
+    }
+}
+
+int main(int argc, char** argv) {
+    int statements = argc > 1 ? atoi(argv[1]) : 100000;
+    int chunk = argc > 2 ? atoi(argv[2]) : 4096;
+
+    int length;
+    char* source = make_program(statements, &length);
+    if (!source) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    double t0 = now();
+    Parser parser;
+    parser_init(&parser, source);
+    ParseResult full = parse(&parser);
+    double t1 = now();
+    if (!full.ast) {
+        printf("out of memory\n");
+        return 1;
+    }
+    int nodes = full.ast->count, diagnostics = full.diagnostic_count;
+    free_parse_result(&full);
+
+    int fed = 0;
+    Progress progress = {0, -1, -1, &fed};
+    PushParser push;
+    double t2 = now();
+    parser_init_push(&push, on_statement, &progress);
+    while (fed < length) {
+        int n = length - fed < chunk ? length - fed : chunk;
+        fed += n;
+        parser_feed(&push, source + fed - n, n);
+    }
+    ParseResult pushed = parser_finish(&push);
+    double t3 = now();
+
+    if (!pushed.ast || pushed.ast->count != nodes || pushed.diagnostic_count != diagnostics) {
+        printf("pushed input parses differently\n");
+        return 1;
+    }
+    printf("%d bytes in %d-byte chunks, %d top-level statements, %d nodes\n", length, chunk,
+           progress.statements, nodes);
+    printf("buffer + parse: %8.3f ms\n", (t1 - t0) * 1e3);
+    printf("push:           %8.3f ms\n", (t3 - t2) * 1e3);
+    printf("first statement after %d bytes, first diagnostic after %d bytes\n",
+           progress.first_statement, progress.first_diagnostic);
+
+    free_parse_result(&pushed);
+    free(source);
+    return 0;
+}
@@ -0,0 +1,110 @@
+/* reparse_bench.c */
+// Compares reparse() after a small edit with parsing the edited source
+// from scratch, on a generated program of nested blocks.
+//
+//   gcc -O2 -o reparse_bench bench/reparse_bench.c src/lexer/*.c src/parser/*.c -pthread
+//   ./reparse_bench [statements] [edits]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/parser.h"
+#include "../include/lexer.h"
+#include "bench.h"
+
+static int write_group(char* out, int i, const void* arg) {
+    (void)arg;
+    return nested_group(out, i, 0, 1);
+}
+
+static char* make_program(int statements, int* length) {
+    return generate_program(statements, 160, NULL, write_group, NULL, length);
+}
+
+// Source with bytes [start, end) replaced by `text`
+static char* apply_edit(const char* source, int length, TextEdit edit, const char* text) {
+    char* edited = malloc(length - (edit.end - edit.start) + edit.inserted_length + 1);
+    if (!edited) {
+        return NULL;
+    }
+    memcpy(edited, source, edit.start);
+    memcpy(edited + edit.start, text, edit.inserted_length);
+    memcpy(edited + edit.start + edit.inserted_length, source + edit.end, length - edit.end);
+    edited[length - (edit.end - edit.start) + edit.inserted_length] = '\0';
+    return edited;
+}
+
+// Time `edits` edits of one kind spread over the source: each replaces
+// `replace` bytes after an occurrence of `anchor` by `text`
+static void run(const char* name, int statements, int edits, const char* anchor, int replace,
+                const char* text) {
+    int length;
+    char* source = make_program(statements, &length);
+    Parser parser;
+    if (!source || !parser_init(&parser, source)) {
+        printf("out of memory\n");
+        exit(1);
+    }
+    ParseResult result = parse(&parser);
+
+    char** sources = malloc((edits + 1) * sizeof(char*));
+    sources[0] = source;
+    double incremental = 0, full = 0;
+    for (int e = 0; e < edits; e++) {
+        // Pick the anchor in the e-th slice of the source
+        const char* at = strstr(source + (long)length * e / edits, anchor);
+        if (!at) {
+            at = strstr(source, anchor);
+        }
+        int start = (int)(at - source) + (int)strlen(anchor);
+        TextEdit edit = {start, start + replace, (int)strlen(text)};
+        char* edited = apply_edit(source, length, edit, text);
+        length += edit.inserted_length - (edit.end - edit.start);
+
+        double t0 = now();
+        NodeId root = reparse(&result, edited, length, edit);
+        double t1 = now();
+        if (!root) {
+            printf("out of memory\n");
+            exit(1);
+        }
+
+        Parser fresh;
+        parser_init(&fresh, edited);
+        ParseResult scratch = parse(&fresh);
+        double t2 = now();
+        if (scratch.ast->count != result.ast->count ||
+            scratch.diagnostic_count != result.diagnostic_count) {
+            printf("%s: reparsed tree differs from a full parse\n", name);
+            exit(1);
+        }
+        free_parse_result(&scratch);
+
+        incremental += t1 - t0;
+        full += t2 - t1;
+        sources[e + 1] = source = edited;
+    }
+
+    printf("%-26s reparse %8.3f us   full parse %9.3f us   (%d nodes)\n", name,
+           incremental * 1e6 / edits, full * 1e6 / edits, result.ast->count);
+
+    free_parse_result(&result);
+    for (int e = 0; e <= edits; e++) {
+        free(sources[e]);
+    }
+    free(sources);
+}
+
+int main(int argc, char** argv) {
+    int statements = argc > 1 ? atoi(argv[1]) : 20000;
+    int edits = argc > 2 ? atoi(argv[2]) : 50;
+
+    // Same token kinds: no node changes
+    run("rename in assignment", statements, edits, "    v", 1, "w");
+    // Same node count, one statement reparsed
+    run("change operator", statements, edits, " * 3 ", 1, "-");
+    // New nodes inside a nested block
+    run("add statement to block", statements, edits, "{\n    ", 0, "x = 1; ");
+    // Statement boundaries move, so the enclosing loop is reparsed
+    run("delete semicolon", statements, edits, " - 1", 1, "");
+    return 0;
+}
@@ -0,0 +1,58 @@
+/* semantic_bench.c */
+// Times analyze_semantics() on generated programs with more and more
+// variables, to show how the cost per declaration grows with the number
+// of names in scope. Parsing is not timed.
+//
+//   gcc -O2 -o semantic_bench bench/semantic_bench.c src/lexer/*.c src/parser/*.c src/semantic/semantic.c -pthread
+//   ./semantic_bench [max variables] [runs]
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/parser.h"
+#include "../include/semantic.h"
+#include "bench.h"
+
+// A declaration, an assignment and a print that also reads the first
+// variable
+static int write_group(char* out, int i, const void* arg) {
+    (void)arg;
+    return sprintf(out, "int v%d;\nv%d = %d;\nprint v%d + v0;\n", i, i, i % 97, i);
+}
+
+static char* make_program(int variables) {
+    return generate_program(variables, 64, NULL, write_group, NULL, NULL);
+}
+
+int main(int argc, char** argv) {
+    int max_variables = argc > 1 ? atoi(argv[1]) : 64000;
+    int runs = argc > 2 ? atoi(argv[2]) : 3;
+
+    for (int variables = 1000; variables <= max_variables; variables *= 2) {
+        char* source = make_program(variables);
+        Parser parser;
+        if (!source || !parser_init(&parser, source)) {
+            printf("out of memory\n");
+            return 1;
+        }
+        ParseResult parsed = parse(&parser);
+        if (!parsed.ast) {
+            printf("out of memory\n");
+            return 1;
+        }
+
+        double best = 1e9;
+        for (int r = 0; r < runs; r++) {
+            double t0 = now();
+            if (!analyze_semantics(parsed.ast)) {
+                printf("analysis failed\n");
+                return 1;
+            }
+            double t1 = now();
+            if (t1 - t0 < best) best = t1 - t0;
+        }
+        printf("%7d variables: %9.3f ms (%8.1f ns/variable)\n", variables, best * 1e3,
+               best * 1e9 / variables);
+        free_parse_result(&parsed);
+        free(source);
+    }
+    return 0;
+}
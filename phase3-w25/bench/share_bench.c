@@ -0,0 +1,72 @@
+/* share_bench.c */
+// Node counts and parse times with and without hash-consing, on a
+// generated program that repeats a small set of subexpressions the way
+// machine-generated code does.
+//
+//   gcc -O2 -o share_bench bench/share_bench.c src/lexer/*.c src/parser/*.c -pthread
+//   ./share_bench [statements] [runs]
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/parser.h"
+#include "../include/lexer.h"
+#include "bench.h"
+
+// An assignment that adds two of a few repeated subexpressions
+static int write_group(char* out, int i, const void* arg) {
+    static const char* parts[] = {"x + 10", "factorial(n)", "(x + 10) * factorial(n)",
+                                  "y - x / 2", "n < 100"};
+    (void)arg;
+    return sprintf(out, "%c = %s + %s;\n", "xyn"[i % 3], parts[i % 5], parts[(i / 5) % 5]);
+}
+
+static char* make_program(int statements) {
+    return generate_program(statements, 96, "int x;\nint y;\nint n;\nx = 1;\ny = 2;\nn = 3;\n",
+                            write_group, NULL, NULL);
+}
+
+// Bytes of the node arrays and statement lists of a tree
+static long tree_bytes(const AST* ast) {
+    long per_node = sizeof(unsigned char) + 3 * sizeof(int) + 2 * sizeof(NodeId);
+    return ast->count * per_node + ast->list_count * (long)sizeof(NodeId);
+}
+
+static void run(const char* name, const char* source, int share, int runs) {
+    double best = 1e9;
+    long nodes = 0, bytes = 0;
+    for (int r = 0; r < runs; r++) {
+        Parser parser;
+        if (!parser_init(&parser, source)) {
+            printf("out of memory\n");
+            exit(1);
+        }
+        parser_set_hash_consing(&parser, share);
+        double t0 = now();
+        ParseResult result = parse(&parser);
+        double t1 = now();
+        if (!result.ast) {
+            printf("out of memory\n");
+            exit(1);
+        }
+        nodes = result.ast->count;
+        bytes = tree_bytes(result.ast);
+        free_parse_result(&result);
+        if (t1 - t0 < best) best = t1 - t0;
+    }
+    printf("%-14s %9ld nodes %8.1f MiB   parse %8.3f ms\n", name, nodes, bytes / 1048576.0,
+           best * 1e3);
+}
+
+int main(int argc, char** argv) {
+    int statements = argc > 1 ? atoi(argv[1]) : 200000;
+    int runs = argc > 2 ? atoi(argv[2]) : 5;
+
+    char* source = make_program(statements);
+    if (!source) {
+        printf("out of memory\n");
+        return 1;
+    }
+    run("tree", source, 0, runs);
+    run("hash-consed", source, 1, runs);
+    free(source);
+    return 0;
+}
@@ -0,0 +1,88 @@
+/* syntax_bench.c */
+// Compares check_syntax() with lexing and parsing the same source into a
+// tree, on a generated program of nested blocks. Every `error_every`-th
+// group has a missing semicolon, so both paths also report diagnostics;
+// the bench checks they report the same ones.
+//
+//   gcc -O2 -o syntax_bench bench/syntax_bench.c src/lexer/*.c src/parser/*.c -pthread
+//   ./syntax_bench [statements] [runs] [error_every]
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/parser.h"
+#include "../include/lexer.h"
+#include "bench.h"
+
+// Every `error_every`-th assignment is missing its semicolon
+static int write_group(char* out, int i, const void* arg) {
+    int error_every = *(const int*)arg;
+    return nested_group(out, i, 0, !(error_every > 0 && i % error_every == error_every - 1));
+}
+
+static char* make_program(int statements, int error_every) {
+    return generate_program(statements, 160, NULL, write_group, &error_every, NULL);
+}
+
+static int same_diagnostics(const ParseResult* a, const ParseResult* b) {
+    if (a->diagnostic_count != b->diagnostic_count) {
+        return 0;
+    }
+    for (int i = 0; i < a->diagnostic_count; i++) {
+        const ParseDiagnostic* x = &a->diagnostics[i];
+        const ParseDiagnostic* y = &b->diagnostics[i];
+        if (x->error != y->error || x->token_index != y->token_index || x->line != y->line ||
+            x->column != y->column) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    int statements = argc > 1 ? atoi(argv[1]) : 200000;
+    int runs = argc > 2 ? atoi(argv[2]) : 5;
+    int error_every = argc > 3 ? atoi(argv[3]) : 1000;
+
+    char* source = make_program(statements, error_every);
+    if (!source) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    double best_full = 1e9, best_check = 1e9;
+    int tokens = 0, nodes = 0, diagnostics = 0;
+    for (int r = 0; r < runs; r++) {
+        double t0 = now();
+        Parser parser;
+        if (!parser_init(&parser, source)) {
+            printf("out of memory\n");
+            return 1;
+        }
+        tokens = parser.tokens->count;
+        ParseResult full = parse(&parser);
+        if (!full.ast) {
+            printf("out of memory\n");
+            return 1;
+        }
+        nodes = full.ast->count;
+        double t1 = now();
+        ParseResult check = check_syntax(source);
+        double t2 = now();
+
+        if (check.out_of_memory || !same_diagnostics(&full, &check)) {
+            printf("check_syntax reports different diagnostics than parse\n");
+            return 1;
+        }
+        diagnostics = check.diagnostic_count;
+        free_parse_result(&full);
+        free_parse_result(&check);
+        if (t1 - t0 < best_full) best_full = t1 - t0;
+        if (t2 - t1 < best_check) best_check = t2 - t1;
+    }
+
+    printf("%d tokens, %d nodes, %d diagnostics\n", tokens, nodes, diagnostics);
+    printf("lex + parse:  %8.3f ms (%.2f ns/token)\n", best_full * 1e3, best_full * 1e9 / tokens);
+    printf("check_syntax: %8.3f ms (%.2f ns/token), %.2fx faster\n", best_check * 1e3,
+           best_check * 1e9 / tokens, best_full / best_check);
+    free(source);
+    return 0;
+}
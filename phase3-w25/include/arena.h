@@ -0,0 +1,37 @@
+/* arena.h */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump-pointer allocator. Memory comes from large blocks and is only
+// released all at once, so building and tearing down an AST costs a
+// handful of mallocs instead of one per node.
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;    // Next block in allocation order
+    size_t size;                // Usable bytes in data
+    size_t used;                // Bytes handed out so far
+    max_align_t data[];         // Block memory, aligned for any type
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock* head;           // First block
+    ArenaBlock* current;        // Block allocations currently come from
+    size_t block_size;          // Size of new blocks
+} Arena;
+
+// Prepare an empty arena. No memory is allocated until the first
+// arena_alloc. A block_size of 0 picks a default of 64 KiB.
+void arena_init(Arena* arena, size_t block_size);
+
+// Allocate size bytes aligned for any type. Returns NULL if memory runs out.
+void* arena_alloc(Arena* arena, size_t size);
+
+// Release everything allocated so far but keep the blocks, so the next
+// compilation reuses them without going back to malloc
+void arena_reset(Arena* arena);
+
+// Return all blocks to the system
+void arena_free(Arena* arena);
+
+#endif /* ARENA_H */
@@ -0,0 +1,74 @@
+/* bytecode.h */
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stdio.h>
+#include "parser.h"
+#include "semantic.h"
+
+// Instructions of the stack machine. Each is one int in the code array;
+// those marked with an operand are followed by one more.
+typedef enum {
+    BC_PUSH,            // Push the operand
+    BC_CONSTANT,        // Push constants[operand] (literals that do not fit an int)
+    BC_LOAD,            // Push variable slot `operand`
+    BC_STORE,           // Pop into variable slot `operand`
+    BC_POP,             // Drop the top of the stack
+    BC_ADD,             // Pop b, pop a, push a op b
+    BC_SUB,
+    BC_MUL,
+    BC_DIV,
+    BC_EQ,              // Comparisons push 1 or 0
+    BC_LT,
+    BC_LE,
+    BC_GT,
+    BC_GE,
+    BC_FACTORIAL,       // Replace the top of the stack by its factorial
+    BC_PRINT,           // Pop and print
+    BC_JUMP,            // Continue at `operand`
+    BC_JUMP_IF_ZERO,    // Pop; continue at `operand` if it was 0
+    BC_HALT
+} Opcode;
+
+// Compiled program
+typedef struct {
+    int* code;          // Instructions and their operands
+    int count;
+    int capacity;
+    long* constants;    // Literals too large for an operand
+    int constant_count;
+    int constant_capacity;
+    int slots;          // Variables, one slot per declaration
+    int max_stack;      // Deepest the operand stack gets
+} Bytecode;
+
+// One semantic error found while compiling
+typedef struct {
+    SemanticErrorType error;
+    Token token;        // Name or keyword the error is about
+    int line;
+} CompileDiagnostic;
+
+// Outcome of a compile. The program should only be run if there are
+// neither syntax nor semantic errors (compile_ok).
+typedef struct {
+    Bytecode program;
+    ParseResult parse;              // Syntax errors; its ast is always NULL
+    CompileDiagnostic* errors;      // Semantic errors in source order
+    int error_count;
+    int error_capacity;
+    int out_of_memory;
+} CompileResult;
+
+// Compile functions
+CompileResult compile_program(const char* input);
+CompileResult compile_buffer(const char* data, int length);
+int compile_ok(const CompileResult* result);
+void print_compile_diagnostics(const CompileResult* result);
+void free_compile_result(CompileResult* result);
+
+// Interpreter functions
+int run_bytecode(const Bytecode* program, FILE* out);
+void print_bytecode(const Bytecode* program);
+
+#endif /* BYTECODE_H */
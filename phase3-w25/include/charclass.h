@@ -0,0 +1,34 @@
+/* charclass.h */
+#ifndef CHARCLASS_H
+#define CHARCLASS_H
+
+// Character classes used by the lexer. Unlike isdigit/isalpha these do not
+// depend on the current locale.
+enum {
+    CC_SPACE   = 1,     // ' ', '\t', '\n'
+    CC_DIGIT   = 2,     // 0-9
+    CC_ALPHA   = 4,     // a-z, A-Z, '_' (may start an identifier)
+    CC_IDENT   = 8      // a-z, A-Z, 0-9, '_' (may continue an identifier)
+};
+
+extern const unsigned char lexer_char_class[256];
+
+#define char_is(c, cls) (lexer_char_class[(unsigned char)(c)] & (cls))
+
+// Run scanners. Each returns a pointer to the first byte in [p, end) that
+// is not in the class, or `end`. The best implementation for the CPU
+// (AVX2, SSE2 or a scalar loop) is chosen once at program start.
+const char* scan_digits(const char* p, const char* end);
+const char* scan_ident(const char* p, const char* end);
+const char* scan_space(const char* p, const char* end);
+
+// Newline scanners used to build line indexes. find_newlines() writes
+// base + (offset from p) of every '\n' in [p, end) to `out` and returns
+// the end of what it wrote; count_newlines() sizes that output.
+int count_newlines(const char* p, const char* end);
+int* find_newlines(const char* p, const char* end, int base, int* out);
+
+// Name of the implementation in use ("avx2", "sse2" or "scalar")
+const char* charclass_impl_name(void);
+
+#endif /* CHARCLASS_H */
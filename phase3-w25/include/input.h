@@ -0,0 +1,52 @@
+/* input.h */
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdio.h>
+#include "tokens.h"
+#include "lexer.h"
+
+// A source file mapped read-only into memory. On systems without mmap the
+// file is read into a heap buffer instead. The data is NOT NUL-terminated:
+// lex it with tokenize_buffer() or lexer_init_buffer(). Token offsets are
+// ints, so files of INT_MAX bytes or more are refused (too_large is set);
+// lex those with input_stream_open() instead.
+typedef struct {
+    const char* data;       // File contents
+    int length;             // Size of the file in bytes
+    int mapped;             // 1 if data is an mmap'd view, 0 if heap-allocated
+    int too_large;          // input_open() failed because the file is too large
+} InputFile;
+
+int input_open(InputFile* file, const char* path);
+void input_close(InputFile* file);
+
+// Chunked streaming input. Only a bounded window of the file is held in
+// memory, so files larger than memory can be tokenized. The window is only
+// lexed up to its last newline: tokens never span a newline, so no token is
+// ever cut at a chunk boundary. The window only grows past its initial size
+// if a single line is longer than it; a line of INT_MAX bytes or more is an
+// error (too_large is set).
+typedef struct {
+    FILE* file;             // File being read
+    char* window;           // Bytes currently held in memory
+    int capacity;           // Allocated size of the window
+    int filled;             // Number of valid bytes in the window
+    long long base;         // File offset of window[0]
+    int at_eof;             // No more bytes to read from the file
+    int too_large;          // A line did not fit in a window of INT_MAX bytes
+    Lexer lexer;            // Lexer over the complete lines of the window
+    StringTable* strings;   // Identifier names, valid for the whole file
+} InputStream;
+
+int input_stream_open(InputStream* stream, const char* path, int window_size);
+void input_stream_close(InputStream* stream);
+
+// Get the next token. Its offset is relative to the current window: read
+// its text with token_lexeme(stream->window, token) before the next call,
+// and add stream->base for the absolute file offset. Returns 0 (with a
+// TOKEN_EOF token) once the whole file has been consumed, or -1 on a read
+// or allocation error.
+int input_stream_next(InputStream* stream, Token* token);
+
+#endif /* INPUT_H */
@@ -0,0 +1,31 @@
+/* intern.h */
+#ifndef INTERN_H
+#define INTERN_H
+
+// Interned identifier names. Each distinct name is stored once and gets a
+// dense integer id (0, 1, 2, ...), so later phases can compare and hash
+// names as integers.
+typedef struct {
+    char* chars;            // Every name, each followed by a NUL
+    int chars_used;
+    int chars_capacity;
+    int* name_offsets;      // Start of name i in chars
+    int* name_lengths;      // Length of name i
+    unsigned* name_hashes;  // Hash of name i
+    int count;              // Number of names
+    int capacity;           // Allocated length of the per-name arrays
+    int* slots;             // Open-addressing hash table of id + 1 (0 = empty)
+    int slot_count;         // Size of slots, a power of two
+} StringTable;
+
+StringTable* string_table_new(void);
+void free_string_table(StringTable* table);
+
+// Id of the name, adding it if it is new. Returns -1 if memory runs out.
+int string_table_intern(StringTable* table, const char* text, int length);
+
+// NUL-terminated text and length of an interned name
+const char* string_table_name(const StringTable* table, int id);
+int string_table_length(const StringTable* table, int id);
+
+#endif /* INTERN_H */
@@ -1,12 +1,78 @@
-/* lexer.h */
-#ifndef LEXER_H
-#define LEXER_H
-
-#include "tokens.h"
-
-// Lexer functions that need to be visible to other files
-Token get_next_token(const char* input, int* pos);
-void print_token(Token token);
-void print_error(ErrorType error, int line, int column, const char* lexeme);
-
-#endif /* LEXER_H */
\ No newline at end of file
+/* lexer.h */
+#ifndef LEXER_H
+#define LEXER_H
+
+#include "tokens.h"
+#include "line_index.h"
+
+// Lexer state. Each caller owns its own Lexer, so separate inputs can be
+// tokenized at the same time (e.g. on different threads) without locks.
+typedef struct {
+    const char* source;         // Input being tokenized
+    int length;                 // Length of the input in bytes
+    int position;               // Offset of the next unread character
+    TokenType last_token_type;  // Type of the previous token returned
+    StringTable* strings;       // Where identifiers are interned (NULL: not interned)
+    int out_of_memory;          // An identifier could not be interned (its id is -1)
+} Lexer;
+
+// Lexer functions that need to be visible to other files
+void lexer_init(Lexer* lexer, const char* input);
+void lexer_init_buffer(Lexer* lexer, const char* data, int length);
+void lexer_resume(Lexer* lexer, const char* data, int length, int position,
+                  TokenType last_token_type);
+Token get_next_token(Lexer* lexer);
+void print_token(LineIndex* lines, Token token);
+void print_error(ErrorType error, int line, int column, const char* lexeme);
+
+// Batch tokenizer: lexes the whole input into a token stream
+TokenStream* tokenize_all(const char* input);
+TokenStream* tokenize_buffer(const char* data, int length);
+TokenStream* tokenize_parallel(const char* data, int length, int threads);
+
+// Pipelined lexing: a lexer thread hands tokens to the parser through a
+// bounded single-producer/single-consumer ring, so the two overlap
+typedef struct LexerPipeline LexerPipeline;
+LexerPipeline* lexer_pipeline_start(const char* data, int length, StringTable* strings);
+int lexer_pipeline_read(LexerPipeline* pipeline, TokenStream* stream);
+void lexer_pipeline_stop(LexerPipeline* pipeline);
+Token token_at(const TokenStream* stream, int index);
+TokenStream* token_stream_new(int capacity);
+int token_stream_reserve(TokenStream* stream, int needed);
+int token_stream_push(TokenStream* stream, Token token);
+void free_token_stream(TokenStream* stream);
+
+// Incremental relexing. An edit replaced bytes [start, end) of the old
+// source with `inserted_length` new bytes.
+typedef struct {
+    int start;              // First byte replaced (old source)
+    int end;                // One past the last byte replaced (old source)
+    int inserted_length;    // Number of bytes that replaced them
+} TextEdit;
+
+// Difference between the old and new token streams: old tokens
+// [first, first + removed) are replaced by `inserted` (whose offsets refer
+// to the new source), and every later old token moves by `offset_shift`.
+typedef struct {
+    int first;              // Index of the first old token replaced
+    int removed;            // Number of old tokens replaced
+    TokenStream* inserted;  // Replacement tokens
+    int offset_shift;       // inserted_length - (end - start)
+} TokenDelta;
+
+// Relex only the part of `new_source` affected by `edit`: start at the last
+// token boundary before it and stop once the new tokens line up with the
+// old stream again. Returns 0 if memory runs out.
+int relex_edit(const TokenStream* old_tokens, const char* new_source, int new_length,
+               TextEdit edit, TokenDelta* delta);
+int token_stream_apply(TokenStream* stream, const TokenDelta* delta);
+void free_token_delta(TokenDelta* delta);
+
+// Lexeme accessors. Token text is not NUL-terminated, so hot paths should
+// use token_lexeme() with token.length (e.g. printf("%.*s", ...)) and
+// diagnostics can use token_copy_lexeme() to get a printable string.
+const char* token_lexeme(const char* source, Token token);
+int token_lexeme_equals(const char* source, Token token, const char* text);
+void token_copy_lexeme(const char* source, Token token, char* buffer, int size);
+
+#endif /* LEXER_H */
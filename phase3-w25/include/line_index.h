@@ -0,0 +1,25 @@
+/* line_index.h */
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+// Line-start index over a source buffer. The lexer only records byte
+// offsets; this turns an offset into a line/column number when a
+// diagnostic actually needs one. Newlines are found with a vectorized scan,
+// and only as far into the source as the largest offset looked up so far,
+// so inputs without errors never pay for it.
+typedef struct {
+    const char* source;     // Buffer the offsets refer to
+    int* starts;            // starts[i] = offset where line i + 1 begins
+    int count;              // Number of line starts found so far
+    int capacity;           // Allocated length of starts
+    int scanned;            // Bytes [0, scanned) have been scanned
+} LineIndex;
+
+void line_index_init(LineIndex* index, const char* source);
+void line_index_free(LineIndex* index);
+
+// Line and column (both starting at 1) of a byte offset in the source
+void line_index_position(LineIndex* index, int offset, int* line, int* column);
+int line_index_line(LineIndex* index, int offset);
+
+#endif /* LINE_INDEX_H */
@@ -1,55 +1,234 @@
-/* parser.h */
-#ifndef PARSER_H
-#define PARSER_H
-
-#include "tokens.h"
-
-// Basic node types for AST
-typedef enum {
-    AST_PROGRAM,        // Program node
-    AST_VARDECL,        // Variable declaration (int x)
-    AST_ASSIGN,         // Assignment (x = 5)
-    AST_PRINT,          // Print statement
-    AST_NUMBER,         // Number literal
-    AST_IDENTIFIER,     // Variable name
-    AST_IF,             // If statement
-    AST_WHILE,          // While statement
-    AST_FACTORIAL,      // Factorial function
-    AST_BINOP,          // Binary operator
-    AST_BLOCK,          // {} blocks
-    AST_REPEAT          // Repeat statement
-    // TODO: Add more node types as needed
-} ASTNodeType;
-
-typedef enum {
-    PARSE_ERROR_NONE,
-    PARSE_ERROR_UNEXPECTED_TOKEN,
-    PARSE_ERROR_MISSING_SEMICOLON,
-    PARSE_ERROR_MISSING_IDENTIFIER,
-    PARSE_ERROR_MISSING_EQUALS,
-    PARSE_ERROR_INVALID_EXPRESSION,
-    PARSE_ERROR_MISSING_PARENTHESIS,
-    PARSE_ERROR_BAD_PARENTHESIS,
-    PARSE_ERROR_MISSING_CONDITION,       // New error type
-    PARSE_ERROR_MISSING_BLOCK,           // New error type
-    PARSE_ERROR_INVALID_OPERATOR,        // New error type
-    PARSE_ERROR_FUNCTION_CALL_ERROR,      // New error type
-    PARSE_ERROR_MISSING_UNTILS,          // New error type
-} ParseError;
-
-// AST Node structure
-typedef struct ASTNode {
-    ASTNodeType type;           // Type of node
-    Token token;               // Token associated with this node
-    struct ASTNode* left;      // Left child
-    struct ASTNode* right;     // Right child
-    // TODO: Add more fields if needed
-} ASTNode;
-
-// Parser functions
-void parser_init(const char* input);
-ASTNode* parse(void);
-void print_ast(ASTNode* node, int level);
-void free_ast(ASTNode* node);
-
-#endif /* PARSER_H */
+/* parser.h */
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "tokens.h"
+#include "lexer.h"
+#include "arena.h"
+
+// Basic node types for AST
+typedef enum {
+    AST_PROGRAM,        // Program node
+    AST_VARDECL,        // Variable declaration (int x)
+    AST_ASSIGN,         // Assignment (x = 5)
+    AST_PRINT,          // Print statement
+    AST_NUMBER,         // Number literal
+    AST_IDENTIFIER,     // Variable name
+    AST_IF,             // If statement
+    AST_WHILE,          // While statement
+    AST_FACTORIAL,      // Factorial function
+    AST_BINOP,          // Binary operator
+    AST_BLOCK,          // {} blocks
+    AST_REPEAT          // Repeat statement
+    // TODO: Add more node types as needed
+} ASTNodeType;
+
+typedef enum {
+    PARSE_ERROR_NONE,
+    PARSE_ERROR_UNEXPECTED_TOKEN,
+    PARSE_ERROR_MISSING_SEMICOLON,
+    PARSE_ERROR_MISSING_IDENTIFIER,
+    PARSE_ERROR_MISSING_EQUALS,
+    PARSE_ERROR_INVALID_EXPRESSION,
+    PARSE_ERROR_MISSING_PARENTHESIS,
+    PARSE_ERROR_BAD_PARENTHESIS,
+    PARSE_ERROR_MISSING_CONDITION,       // New error type
+    PARSE_ERROR_MISSING_BLOCK,           // New error type
+    PARSE_ERROR_INVALID_OPERATOR,        // New error type
+    PARSE_ERROR_FUNCTION_CALL_ERROR,      // New error type
+    PARSE_ERROR_MISSING_UNTILS,          // New error type
+} ParseError;
+
+// Handle of a node in an AST. Node 0 is an empty sentinel, so 0 also
+// means "no node" wherever a child is optional.
+typedef int NodeId;
+
+// AST stored as parallel arrays indexed by NodeId. Each node keeps the
+// index of its token rather than a copy, and nodes are laid out in
+// preorder, so walks from the root read the arrays front to back.
+//
+// Sequence nodes (AST_PROGRAM, AST_BLOCK) have no left/right children.
+// Their statements sit next to each other in `lists`: left is the index
+// of the first one and right is how many there are.
+//
+// Every node also records the range of tokens it was parsed from. The
+// span of a statement includes the tokens skipped when recovering from an
+// error in it, so the spans of a sequence's statements are back to back
+// except where a statement was dropped.
+typedef struct {
+    unsigned char* kinds;       // ASTNodeType of each node
+    int* tokens;                // Index of each node's token in `stream`
+    int* starts;                // First token of each node's span
+    int* ends;                  // One past the last token of each node's span
+    NodeId* left;               // Left child of each node (0: none)
+    NodeId* right;              // Right child of each node (0: none)
+    int count;                  // Number of nodes, including the sentinel
+    int capacity;               // Allocated length of the arrays
+    NodeId* lists;              // Statements of all sequence nodes
+    int list_count;             // Used length of lists
+    int list_capacity;          // Allocated length of lists
+    NodeId root;                // Program node
+    TokenStream* stream;        // Tokens the nodes refer to
+    const char* source;         // Source buffer the tokens point into
+    int owns_stream;            // Stream is freed together with the tree
+    int owns_source;            // Source is freed together with the tree (pushed input)
+    Arena* arena;               // Where the tree and arrays came from (NULL: malloc)
+    int shared;                 // Built with hash-consing: expression nodes may have
+                                // several parents and are not all in preorder
+} AST;
+
+static inline ASTNodeType ast_kind(const AST* ast, NodeId node) {
+    return (ASTNodeType)ast->kinds[node];
+}
+
+static inline Token ast_token(const AST* ast, NodeId node) {
+    return token_at(ast->stream, ast->tokens[node]);
+}
+
+static inline int ast_is_sequence(ASTNodeType kind) {
+    return kind == AST_PROGRAM || kind == AST_BLOCK;
+}
+
+// Statements of a sequence node
+static inline const NodeId* ast_children(const AST* ast, NodeId node) {
+    return ast->lists + ast->left[node];
+}
+
+static inline int ast_child_count(const AST* ast, NodeId node) {
+    return ast->right[node];
+}
+
+// One parse error. Errors are collected rather than printed, so the
+// parser can run inside a long-lived process.
+typedef struct {
+    ParseError error;           // What went wrong
+    Token token;                // Token the error was found at
+    int token_index;            // Index of that token in the stream
+    int unit;                   // First token of the statement or block it belongs to
+    int line;                   // Position of that token
+    int column;
+} ParseDiagnostic;
+
+// Outcome of a parse. The tree is built even when there are errors:
+// statements that failed to parse are left out of it.
+typedef struct {
+    AST* ast;                   // Tree (NULL if memory ran out or only the syntax was checked)
+    const char* source;         // Source buffer the diagnostics point into
+    ParseDiagnostic* diagnostics;   // Errors in source order
+    int diagnostic_count;
+    int diagnostic_capacity;
+    int out_of_memory;          // Some nodes or diagnostics were lost
+} ParseResult;
+
+// Grammar events reported by a single-pass parse (parse_single_pass),
+// for clients that translate the input as it is recognized instead of
+// walking a tree. Expressions are reported in postfix order, and every
+// event that opens a construct is matched by the one that closes it,
+// unless a syntax error cuts the construct short.
+typedef enum {
+    PARSE_EVENT_STATEMENT,          // A statement starts (token: its first token)
+    PARSE_EVENT_STATEMENT_END,      // The statement ended or was skipped
+    PARSE_EVENT_BLOCK,              // '{' of a block
+    PARSE_EVENT_BLOCK_END,          // Its statements ended
+    PARSE_EVENT_NUMBER,             // Number literal
+    PARSE_EVENT_IDENTIFIER,         // Variable read
+    PARSE_EVENT_BINARY,             // Both operands were reported (token: the operator)
+    PARSE_EVENT_FACTORIAL,          // The argument was reported (token: 'factorial')
+    PARSE_EVENT_DECLARATION,        // Declared name
+    PARSE_EVENT_ASSIGN_TARGET,      // Assigned name, before the value
+    PARSE_EVENT_ASSIGN,             // The value was reported (token: the assigned name)
+    PARSE_EVENT_PRINT,              // The value was reported (token: 'print')
+    PARSE_EVENT_PRINT_OPERAND,      // A print statement is about to be parsed as an operand
+    PARSE_EVENT_PRINT_OPERAND_END,  // That print statement ended
+    PARSE_EVENT_LOOP,               // 'while' or 'repeat', before the condition or body
+    PARSE_EVENT_CONDITION,          // The condition of an if or while was reported
+    PARSE_EVENT_IF_END,             // The body of an if ended
+    PARSE_EVENT_WHILE_END,          // The body of a while ended
+    PARSE_EVENT_UNTIL               // The condition of a repeat was reported
+} ParseEvent;
+
+typedef void (*ParseEventHandler)(void* state, ParseEvent event, Token token);
+
+// Parser state. The caller owns it, so several inputs can be parsed
+// at the same time.
+typedef struct {
+    const char* source;         // Source buffer the tokens point into
+    TokenStream* tokens;        // Token stream walked by index
+    int token_index;            // Index of the current token
+    int token_base;             // Index of the stream's first token (syntax-only mode)
+    int syntax_only;            // Recognize the input without building nodes
+    Lexer lexer;                // Where syntax-only mode gets its tokens
+    LexerPipeline* pipeline;    // Lexer thread still adding tokens (NULL: none)
+    Token current_token;        // Current token being processed
+    int owns_tokens;            // tokens is freed along with the tree
+    LineIndex lines;            // Line numbers, only computed for errors
+    Arena* arena;               // Where finished trees are allocated (NULL: malloc)
+    AST* tree;                  // Tree under construction, in creation order
+    NodeId* pending;            // Statements of the open sequences, innermost last
+    int pending_count;
+    int pending_capacity;
+    int panic;                  // An error was reported and the statement not yet skipped
+    int unit;                   // First token of the innermost statement or block
+    int hash_consing;           // Identical expression subtrees share one node
+    NodeId* shared;             // Hash table of shareable nodes (0: empty slot)
+    int shared_count;
+    int shared_capacity;
+    ParseResult result;         // Diagnostics collected so far
+    ParseEventHandler on_event; // Grammar events of a single-pass parse (NULL: none)
+    void* event_state;
+} Parser;
+
+// A top-level statement of pushed input, reported as soon as it is
+// complete. The tree is the one under construction: its nodes are in
+// creation order, and it is only valid during the callback.
+typedef struct {
+    const AST* tree;            // Tree under construction
+    NodeId node;                // The statement (0: it failed to parse)
+    int start;                  // Its tokens [start, end)
+    int end;
+    const ParseDiagnostic* diagnostics;     // Errors found in it
+    int diagnostic_count;
+} PushedStatement;
+
+typedef void (*StatementCallback)(void* user, const PushedStatement* statement);
+
+// Parser fed with input as it arrives (push mode). Bytes are lexed up to
+// the last whitespace received, since a token may continue in the next
+// chunk, and each top-level statement is parsed once it is complete.
+typedef struct {
+    Parser parser;              // Parses the complete statements
+    char* buffer;               // Input received so far
+    int length;
+    int capacity;
+    int depth;                  // Brace depth after the last token lexed
+    int ready;                  // Tokens before this one may hold complete statements
+    NodeId program;             // Program node the statements go into
+    int base;                   // Where the program's statements start in pending
+    StatementCallback on_statement;
+    void* user;
+} PushParser;
+
+// Parser functions
+int parser_init(Parser* parser, const char* input);
+int parser_init_pipelined(Parser* parser, const char* input);
+void parser_init_tokens(Parser* parser, const char* input, TokenStream* stream);
+void parser_set_arena(Parser* parser, Arena* arena);
+void parser_set_hash_consing(Parser* parser, int enabled);
+ParseResult parse(Parser* parser);
+ParseResult parse_parallel(Parser* parser, int threads);
+ParseResult check_syntax(const char* input);
+ParseResult check_syntax_buffer(const char* data, int length);
+ParseResult parse_single_pass(const char* data, int length, StringTable* strings,
+                              ParseEventHandler handler, void* state);
+NodeId reparse(ParseResult* result, const char* new_source, int new_length, TextEdit edit);
+int parser_init_push(PushParser* push, StatementCallback on_statement, void* user);
+int parser_feed(PushParser* push, const char* data, int length);
+ParseResult parser_finish(PushParser* push);
+void parser_free_push(PushParser* push);
+void parser_free(Parser* parser);
+void print_parse_diagnostics(const ParseResult* result);
+void free_parse_result(ParseResult* result);
+void print_ast(const AST* ast, NodeId node, int level);
+void free_ast(AST* ast);
+
+#endif /* PARSER_H */
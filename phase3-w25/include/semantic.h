@@ -1,52 +1,100 @@
-#ifndef SEMANTIC_H
-#define SEMANTIC_H
-
-// Basic symbol structure
-typedef struct Symbol {
-    char name[100];          // Variable name
-    int type;                // Data type (int, etc.)
-    int scope_level;         // Scope nesting level
-    int line_declared;       // Line where declared
-    int is_initialized;      // Has been assigned a value?
-    struct Symbol* next;     // For linked list implementation
-} Symbol;
-
-// Symbol table
-typedef struct {
-    Symbol* head;            // First symbol in the table
-    int current_scope;       // Current scope level
-} SymbolTable;
-
-// Semantic errors
-typedef enum {
-    SEM_ERROR_NONE,
-    SEM_ERROR_UNDECLARED_VARIABLE,
-    SEM_ERROR_REDECLARED_VARIABLE,
-    SEM_ERROR_TYPE_MISMATCH,
-    SEM_ERROR_UNINITIALIZED_VARIABLE,
-    SEM_ERROR_INVALID_OPERATION,
-    SEM_ERROR_SEMANTIC_ERROR  // Generic semantic error
-} SemanticErrorType;
-
-// Main semantic analysis function
-int analyze_semantics(ASTNode* ast);
-
-// Check a variable declaration
-int check_declaration(ASTNode* node, SymbolTable* table);
-
-// Check a variable assignment
-int check_assignment(ASTNode* node, SymbolTable* table);
-
-// Check an expression for type correctness
-int check_expression(ASTNode* node, SymbolTable* table);
-
-// Check a block of statements, handling scope
-int check_block(ASTNode* node, SymbolTable* table);
-
-// Check a condition (e.g., in if statements)
-int check_condition(ASTNode* node, SymbolTable* table);
-
-// Report semantic errors
-void semantic_error(SemanticErrorType error, const char* name, int line);
-
-#endif /* SEMANTIC_H */
+#ifndef SEMANTIC_H
+#define SEMANTIC_H
+
+#include "parser.h"
+#include "line_index.h"
+
+// Basic symbol structure
+typedef struct Symbol {
+    int name_id;             // Interned name (token id of the declaration)
+    int type;                // Data type (int, etc.)
+    int scope_level;         // Scope nesting level
+    int declared_at;         // Source offset of the declaration
+    int is_initialized;      // Has been assigned a value?
+    int shadowed;            // Outer declaration of the same name it hides (-1: none)
+} Symbol;
+
+// Entry of the name table: the innermost live declaration of one name
+typedef struct {
+    int name_id;             // -1: empty entry
+    int symbol;              // -1: the name is not declared in any open scope
+} SymbolEntry;
+
+// Declarations that the names of a tree resolve to, recorded by
+// resolve_names() so later passes can index a frame instead of looking
+// names up. The arrays are indexed by NodeId. A symbol's frame slot is
+// its position on the symbol stack, so slots are reused once a scope
+// is left.
+typedef struct {
+    int* slots;              // Identifiers, assignment targets and declarations:
+                             // frame slot of the declaration (-1: not resolved)
+    int* depths;             // Scope depth of that declaration (-1: not resolved)
+    int* frame_sizes;        // Program and block nodes: most slots live at once
+                             // while it runs, enclosing scopes included
+    int count;               // Length of the arrays (the tree's node count)
+} NameResolution;
+
+// Symbol table
+// Live symbols are kept on one contiguous stack in declaration order, so
+// the symbols of the innermost scope are always on top. A scope's
+// watermark is where its first symbol sits; leaving the scope pops the
+// stack back down to it. Names are looked up in an open-addressing hash
+// table keyed by name id; its entry for a name is the top of that name's
+// shadow chain. Symbols are referred to by their index on the stack, and
+// a Symbol pointer is only valid until the next add_symbol().
+typedef struct {
+    Symbol* symbols;         // Stack of live symbols
+    int symbol_count;
+    int symbol_capacity;
+    SymbolEntry* entries;    // Hash table of names, a power of two in size
+    int entry_count;         // Names with an entry
+    int entry_capacity;
+    int current_scope;       // Current scope level
+    int frame_peak;          // Most symbols live at once in the innermost open sequence
+    NameResolution* names;   // Where resolved names are recorded (NULL: nowhere)
+    NodeId statement;        // Statement whose expressions are being checked
+    int next_use;            // Hash-consed trees: token where the next expression
+                             // node checked in that statement is looked for
+    int out_of_memory;       // A name in the tree was never interned (id -1)
+    const AST* ast;          // Tree being checked
+    const char* source;      // Source buffer the AST tokens point into
+    LineIndex lines;         // Line numbers for error messages
+} SymbolTable;
+
+// Semantic errors
+typedef enum {
+    SEM_ERROR_NONE,
+    SEM_ERROR_UNDECLARED_VARIABLE,
+    SEM_ERROR_REDECLARED_VARIABLE,
+    SEM_ERROR_TYPE_MISMATCH,
+    SEM_ERROR_UNINITIALIZED_VARIABLE,
+    SEM_ERROR_INVALID_OPERATION,
+    SEM_ERROR_SEMANTIC_ERROR  // Generic semantic error
+} SemanticErrorType;
+
+// Main semantic analysis function
+int analyze_semantics(const AST* ast);
+
+// Semantic analysis that also records what each name resolves to
+int resolve_names(const AST* ast, NameResolution* names);
+void free_name_resolution(NameResolution* names);
+
+// Check a variable declaration
+int check_declaration(NodeId node, SymbolTable* table);
+
+// Check a variable assignment
+int check_assignment(NodeId node, SymbolTable* table);
+
+// Check an expression for type correctness
+int check_expression(NodeId node, SymbolTable* table);
+
+// Check a block of statements, handling scope
+int check_block(NodeId node, SymbolTable* table);
+
+// Check a condition (e.g., in if statements)
+int check_condition(NodeId node, SymbolTable* table);
+
+// Report semantic errors
+void semantic_error(SemanticErrorType error, const char* name, int length, int line);
+
+#endif /* SEMANTIC_H */
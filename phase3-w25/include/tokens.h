@@ -1,44 +1,81 @@
-/* tokens.h */
-#ifndef TOKENS_H
-#define TOKENS_H
-
-typedef enum {
-    TOKEN_EOF,
-    TOKEN_NUMBER,      // e.g., "123", "456"
-    TOKEN_OPERATOR,    // +, -, *, /
-    TOKEN_IDENTIFIER,  // Variable names
-    TOKEN_EQUALS,      // =
-    TOKEN_COMPARE,     // <, <=, ==, >=, >
-    TOKEN_SEMICOLON,   // ;
-    TOKEN_LPAREN,      // (
-    TOKEN_RPAREN,      // )
-    TOKEN_LBRACE,      // {
-    TOKEN_RBRACE,      // }
-    TOKEN_IF,          // if keyword
-    TOKEN_WHILE,       // while keyword
-    TOKEN_INT,         // int keyword
-    TOKEN_PRINT,       // print keyword
-    TOKEN_FACT,        // factorial keyword
-    TOKEN_REPEAT,      // repeat keyword
-    TOKEN_UNTIL,       // until keyword
-    TOKEN_ERROR        // error
-} TokenType;
-
-typedef enum {
-    ERROR_NONE,
-    ERROR_INVALID_CHAR,
-    ERROR_INVALID_NUMBER,
-    ERROR_CONSECUTIVE_OPERATORS,
-    ERROR_INVALID_IDENTIFIER,
-    ERROR_UNEXPECTED_TOKEN
-} ErrorType;
-
-typedef struct {
-    TokenType type;
-    char lexeme[100];   // Actual text of the token
-    int line;           // Line number in source file
-    int column; // Added column tracking
-    ErrorType error;    // Error type if any
-} Token;
-
-#endif /* TOKENS_H */
+/* tokens.h */
+#ifndef TOKENS_H
+#define TOKENS_H
+
+#include "intern.h"
+
+typedef enum {
+    TOKEN_EOF,
+    TOKEN_NUMBER,      // e.g., "123", "456"
+    TOKEN_OPERATOR,    // +, -, *, /
+    TOKEN_IDENTIFIER,  // Variable names
+    TOKEN_EQUALS,      // =
+    TOKEN_COMPARE,     // <, <=, ==, >=, >
+    TOKEN_SEMICOLON,   // ;
+    TOKEN_LPAREN,      // (
+    TOKEN_RPAREN,      // )
+    TOKEN_LBRACE,      // {
+    TOKEN_RBRACE,      // }
+    TOKEN_IF,          // if keyword
+    TOKEN_WHILE,       // while keyword
+    TOKEN_INT,         // int keyword
+    TOKEN_PRINT,       // print keyword
+    TOKEN_FACT,        // factorial keyword
+    TOKEN_REPEAT,      // repeat keyword
+    TOKEN_UNTIL,       // until keyword
+    TOKEN_ERROR        // error
+} TokenType;
+
+// Which operator a TOKEN_OPERATOR or TOKEN_COMPARE token is, so later
+// phases never need to compare operator text
+typedef enum {
+    OP_NONE,           // Not an operator
+    OP_ADD,            // +
+    OP_SUB,            // -
+    OP_MUL,            // *
+    OP_DIV,            // /
+    OP_EQ,             // ==
+    OP_LT,             // <
+    OP_LE,             // <=
+    OP_GT,             // >
+    OP_GE,             // >=
+    OP_KIND_COUNT
+} OperatorKind;
+
+typedef enum {
+    ERROR_NONE,
+    ERROR_INVALID_CHAR,
+    ERROR_INVALID_NUMBER,
+    ERROR_CONSECUTIVE_OPERATORS,
+    ERROR_INVALID_IDENTIFIER,
+    ERROR_UNEXPECTED_TOKEN
+} ErrorType;
+
+// A token is a slice of the source buffer: it records where its text
+// starts and how long it is instead of carrying a copy of the lexeme.
+// Line and column numbers are derived from the offset on demand (see
+// line_index.h).
+typedef struct {
+    TokenType type;
+    int offset;         // Start of the lexeme in the source buffer
+    int length;         // Length of the lexeme in bytes
+    ErrorType error;    // Error type if any
+    int id;             // Interned name of an identifier, -1 for other tokens
+    OperatorKind op;    // Operator kind, OP_NONE for non-operators
+} Token;
+
+// Whole-input token stream stored as parallel arrays (struct of arrays):
+// element i of every array describes token i. The last token is TOKEN_EOF.
+typedef struct {
+    unsigned char* types;   // TokenType of each token
+    int* offsets;           // Start of each lexeme in the source buffer
+    int* lengths;           // Length of each lexeme
+    unsigned char* errors;  // ErrorType of each token
+    int* ids;               // Interned name id of each token (-1 if none)
+    unsigned char* ops;     // OperatorKind of each token
+    StringTable* strings;   // Names the ids refer to (owned by the stream)
+    int count;              // Number of tokens, including the EOF token
+    int capacity;           // Allocated length of each array
+} TokenStream;
+
+#endif /* TOKENS_H */
@@ -0,0 +1,453 @@
+/* compile.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "../../include/bytecode.h"
+#include "../../include/line_index.h"
+
+// One-pass compiler. The parser runs in single-pass mode and reports each
+// construct as it recognizes it; the handler below checks declarations
+// and emits code for it on the spot, so no tree is ever built. The checks
+// are the ones analyze_semantics() makes, in the same order: for input
+// without syntax errors both report the same semantic errors.
+
+// Bookkeeping of a statement, so one that a syntax error cut short
+// cannot leave anything behind on the compiler's stacks
+typedef struct {
+    int values;
+    int labels;
+    int targets;
+    int quiet;
+} StatementFrame;
+
+typedef struct {
+    CompileResult* result;
+    Bytecode* program;
+    const char* source;
+    LineIndex lines;
+
+    // Per interned name
+    int* slot_of;               // Variable slot (-1: not declared)
+    unsigned char* initialized; // Has been assigned a valid value
+    int name_capacity;
+
+    // One entry per value on the operand stack at run time: whether the
+    // expression that produces it passed its checks
+    unsigned char* values;
+    int value_count;
+    int value_capacity;
+
+    int* labels;                // Loop starts and jumps to patch, innermost last
+    int label_count;
+    int label_capacity;
+
+    int* targets;               // Names of the assignments being compiled
+    int target_count;
+    int target_capacity;
+
+    StatementFrame* frames;     // Open statements, innermost last
+    int frame_count;
+    int frame_capacity;
+
+    int quiet;                  // > 0: do not report errors. analyze_semantics()
+                                // does not look inside assignments to undeclared
+                                // names, nor inside operations it rejects.
+} Compiler;
+
+// Make room for `needed` items of `size` bytes in a growable array
+static int reserve(void** items, int* capacity, int needed, size_t size) {
+    if (needed <= *capacity) {
+        return 1;
+    }
+    int grown = *capacity ? *capacity * 2 : 64;
+    while (grown < needed) {
+        grown *= 2;
+    }
+    void* bigger = realloc(*items, (size_t)grown * size);
+    if (!bigger) {
+        return 0;
+    }
+    *items = bigger;
+    *capacity = grown;
+    return 1;
+}
+
+static void emit(Compiler* c, int word) {
+    Bytecode* program = c->program;
+    if (!reserve((void**)&program->code, &program->capacity, program->count + 1, sizeof(int))) {
+        c->result->out_of_memory = 1;
+        return;
+    }
+    program->code[program->count++] = word;
+}
+
+static void emit_operand(Compiler* c, Opcode op, int operand) {
+    emit(c, op);
+    emit(c, operand);
+}
+
+static void report(Compiler* c, SemanticErrorType error, Token token) {
+    if (c->quiet) {
+        return;
+    }
+    CompileResult* result = c->result;
+    if (!reserve((void**)&result->errors, &result->error_capacity, result->error_count + 1,
+                 sizeof(CompileDiagnostic))) {
+        result->out_of_memory = 1;
+        return;
+    }
+    CompileDiagnostic* diagnostic = &result->errors[result->error_count++];
+    diagnostic->error = error;
+    diagnostic->token = token;
+    diagnostic->line = line_index_line(&c->lines, token.offset);
+}
+
+static void push_value(Compiler* c, int valid) {
+    if (!reserve((void**)&c->values, &c->value_capacity, c->value_count + 1, 1)) {
+        c->result->out_of_memory = 1;
+        return;
+    }
+    c->values[c->value_count++] = (unsigned char)valid;
+    if (c->value_count > c->program->max_stack) {
+        c->program->max_stack = c->value_count;
+    }
+}
+
+// Validity of the innermost value; a missing one (after a syntax error)
+// counts as invalid
+static int pop_value(Compiler* c) {
+    return c->value_count > 0 ? c->values[--c->value_count] : 0;
+}
+
+static void push_label(Compiler* c, int label) {
+    if (!reserve((void**)&c->labels, &c->label_capacity, c->label_count + 1, sizeof(int))) {
+        c->result->out_of_memory = 1;
+        return;
+    }
+    c->labels[c->label_count++] = label;
+}
+
+static int pop_label(Compiler* c) {
+    return c->label_count > 0 ? c->labels[--c->label_count] : -1;
+}
+
+// Point the jump whose operand is at `label` to the next instruction
+static void patch(Compiler* c, int label) {
+    if (label >= 0 && label < c->program->count) {
+        c->program->code[label] = c->program->count;
+    }
+}
+
+// Make sure the per-name arrays cover name `id`. Returns 0 if memory runs out.
+static int know_name(Compiler* c, int id) {
+    if (id < 0) {
+        c->result->out_of_memory = 1;
+        return 0;
+    }
+    int capacity = c->name_capacity;
+    if (!reserve((void**)&c->slot_of, &capacity, id + 1, sizeof(int))) {
+        c->result->out_of_memory = 1;
+        return 0;
+    }
+    unsigned char* initialized = realloc(c->initialized, capacity);
+    if (!initialized) {
+        c->result->out_of_memory = 1;
+        return 0;
+    }
+    c->initialized = initialized;
+    for (int i = c->name_capacity; i < capacity; i++) {
+        c->slot_of[i] = -1;
+        c->initialized[i] = 0;
+    }
+    c->name_capacity = capacity;
+    return 1;
+}
+
+// Value of a number literal, wrapping like the machine's arithmetic
+static long number_value(const char* source, Token token) {
+    unsigned long value = 0;
+    for (int i = 0; i < token.length; i++) {
+        value = value * 10 + (unsigned long)(source[token.offset + i] - '0');
+    }
+    return (long)value;
+}
+
+static void compile_number(Compiler* c, Token token) {
+    long value = number_value(c->source, token);
+    if (value >= INT_MIN && value <= INT_MAX) {
+        emit_operand(c, BC_PUSH, (int)value);
+    } else {
+        Bytecode* program = c->program;
+        if (!reserve((void**)&program->constants, &program->constant_capacity,
+                     program->constant_count + 1, sizeof(long))) {
+            c->result->out_of_memory = 1;
+            return;
+        }
+        program->constants[program->constant_count] = value;
+        emit_operand(c, BC_CONSTANT, program->constant_count++);
+    }
+    push_value(c, 1);
+}
+
+static void compile_identifier(Compiler* c, Token token) {
+    if (!know_name(c, token.id)) {
+        return;
+    }
+    int slot = c->slot_of[token.id];
+    int valid = 0;
+    if (slot < 0) {
+        report(c, SEM_ERROR_UNDECLARED_VARIABLE, token);
+    } else if (!c->initialized[token.id]) {
+        report(c, SEM_ERROR_UNINITIALIZED_VARIABLE, token);
+    } else {
+        valid = 1;
+    }
+    emit_operand(c, BC_LOAD, slot < 0 ? 0 : slot);
+    push_value(c, valid);
+}
+
+// Instruction of each binary operator kind
+static const Opcode binary_opcode[OP_KIND_COUNT] = {
+    BC_HALT,    // OP_NONE
+    BC_ADD,     // OP_ADD
+    BC_SUB,     // OP_SUB
+    BC_MUL,     // OP_MUL
+    BC_DIV,     // OP_DIV
+    BC_EQ,      // OP_EQ
+    BC_LT,      // OP_LT
+    BC_LE,      // OP_LE
+    BC_GT,      // OP_GT
+    BC_GE,      // OP_GE
+};
+
+static void compile_declaration(Compiler* c, Token token) {
+    if (!know_name(c, token.id)) {
+        return;
+    }
+    // Blocks do not open scopes in analyze_semantics() either, so every
+    // name is declared once for the whole program
+    if (c->slot_of[token.id] >= 0) {
+        report(c, SEM_ERROR_REDECLARED_VARIABLE, token);
+        return;
+    }
+    c->slot_of[token.id] = c->program->slots++;
+}
+
+static void begin_assignment(Compiler* c, Token token) {
+    if (!know_name(c, token.id)) {
+        return;
+    }
+    if (!reserve((void**)&c->targets, &c->target_capacity, c->target_count + 1, sizeof(int))) {
+        c->result->out_of_memory = 1;
+        return;
+    }
+    c->targets[c->target_count++] = token.id;
+    if (c->slot_of[token.id] < 0) {
+        report(c, SEM_ERROR_UNDECLARED_VARIABLE, token);
+        c->quiet++;
+    }
+}
+
+static void end_assignment(Compiler* c) {
+    int valid = pop_value(c);
+    if (c->target_count == 0) {
+        return;
+    }
+    int id = c->targets[--c->target_count];
+    int slot = c->slot_of[id];
+    if (slot < 0) {
+        c->quiet--;
+        return;
+    }
+    if (valid) {
+        c->initialized[id] = 1;
+    }
+    emit_operand(c, BC_STORE, slot);
+}
+
+static void begin_statement(Compiler* c, Token token) {
+    if (!reserve((void**)&c->frames, &c->frame_capacity, c->frame_count + 1,
+                 sizeof(StatementFrame))) {
+        c->result->out_of_memory = 1;
+        return;
+    }
+    StatementFrame* frame = &c->frames[c->frame_count++];
+    frame->values = c->value_count;
+    frame->labels = c->label_count;
+    frame->targets = c->target_count;
+    frame->quiet = c->quiet;
+
+    // analyze_semantics() rejects a factorial used as a statement without
+    // checking its argument
+    if (token.type == TOKEN_FACT) {
+        report(c, SEM_ERROR_INVALID_OPERATION, token);
+        c->quiet++;
+    }
+}
+
+static void end_statement(Compiler* c) {
+    if (c->frame_count == 0) {
+        return;
+    }
+    StatementFrame* frame = &c->frames[--c->frame_count];
+    while (c->value_count > frame->values) {
+        pop_value(c);
+        emit(c, BC_POP);
+    }
+    c->label_count = frame->labels;
+    c->target_count = frame->targets;
+    c->quiet = frame->quiet;
+}
+
+static void on_event(void* state, ParseEvent event, Token token) {
+    Compiler* c = state;
+    switch (event) {
+        case PARSE_EVENT_STATEMENT:
+            begin_statement(c, token);
+            break;
+        case PARSE_EVENT_STATEMENT_END:
+            end_statement(c);
+            break;
+        case PARSE_EVENT_NUMBER:
+            compile_number(c, token);
+            break;
+        case PARSE_EVENT_IDENTIFIER:
+            compile_identifier(c, token);
+            break;
+        case PARSE_EVENT_BINARY: {
+            int right = pop_value(c);
+            int left = pop_value(c);
+            emit(c, binary_opcode[token.op]);
+            push_value(c, left && right);
+            break;
+        }
+        case PARSE_EVENT_FACTORIAL: {
+            int valid = pop_value(c);
+            if (!valid) {
+                report(c, SEM_ERROR_TYPE_MISMATCH, token);
+            }
+            emit(c, BC_FACTORIAL);
+            push_value(c, valid);
+            break;
+        }
+        case PARSE_EVENT_DECLARATION:
+            compile_declaration(c, token);
+            break;
+        case PARSE_EVENT_ASSIGN_TARGET:
+            begin_assignment(c, token);
+            break;
+        case PARSE_EVENT_ASSIGN:
+            end_assignment(c);
+            break;
+        case PARSE_EVENT_PRINT:
+            pop_value(c);
+            emit(c, BC_PRINT);
+            break;
+        case PARSE_EVENT_PRINT_OPERAND:
+            // A print statement is not a value; its operand is not checked
+            report(c, SEM_ERROR_INVALID_OPERATION, token);
+            c->quiet++;
+            break;
+        case PARSE_EVENT_PRINT_OPERAND_END:
+            c->quiet--;
+            push_value(c, 0);
+            break;
+        case PARSE_EVENT_LOOP:
+            push_label(c, c->program->count);
+            break;
+        case PARSE_EVENT_CONDITION:
+            pop_value(c);
+            emit_operand(c, BC_JUMP_IF_ZERO, -1);
+            push_label(c, c->program->count - 1);
+            break;
+        case PARSE_EVENT_IF_END:
+            patch(c, pop_label(c));
+            break;
+        case PARSE_EVENT_WHILE_END: {
+            int exit = pop_label(c);
+            emit_operand(c, BC_JUMP, pop_label(c));
+            patch(c, exit);
+            break;
+        }
+        case PARSE_EVENT_UNTIL:
+            // Go round again while the condition is false
+            pop_value(c);
+            emit_operand(c, BC_JUMP_IF_ZERO, pop_label(c));
+            break;
+        case PARSE_EVENT_BLOCK:
+        case PARSE_EVENT_BLOCK_END:
+            // Blocks do not open scopes (see compile_declaration)
+            break;
+    }
+}
+
+// Compile `length` bytes of source in one pass, without building a tree.
+// Syntax errors end up in result.parse, semantic errors in result.errors.
+CompileResult compile_buffer(const char* data, int length) {
+    CompileResult result;
+    memset(&result, 0, sizeof(CompileResult));
+
+    Compiler c;
+    memset(&c, 0, sizeof(Compiler));
+    c.result = &result;
+    c.program = &result.program;
+    c.source = data;
+    line_index_init(&c.lines, data);
+
+    StringTable* strings = string_table_new();
+    if (!strings) {
+        result.out_of_memory = 1;
+        line_index_free(&c.lines);
+        return result;
+    }
+    result.parse = parse_single_pass(data, length, strings, on_event, &c);
+    emit(&c, BC_HALT);
+    if (result.parse.out_of_memory) {
+        result.out_of_memory = 1;
+    }
+
+    free_string_table(strings);
+    line_index_free(&c.lines);
+    free(c.slot_of);
+    free(c.initialized);
+    free(c.values);
+    free(c.labels);
+    free(c.targets);
+    free(c.frames);
+    return result;
+}
+
+// Compile a whole NUL-terminated string
+CompileResult compile_program(const char* input) {
+    return compile_buffer(input, (int)strlen(input));
+}
+
+// Whether the program is complete and may be run
+int compile_ok(const CompileResult* result) {
+    return !result->out_of_memory && result->parse.diagnostic_count == 0 &&
+           result->error_count == 0;
+}
+
+// Print the syntax errors, then the semantic errors, in the formats of
+// print_parse_diagnostics() and semantic_error()
+void print_compile_diagnostics(const CompileResult* result) {
+    print_parse_diagnostics(&result->parse);
+    for (int i = 0; i < result->error_count; i++) {
+        const CompileDiagnostic* diagnostic = &result->errors[i];
+        semantic_error(diagnostic->error, token_lexeme(result->parse.source, diagnostic->token),
+                       diagnostic->token.length, diagnostic->line);
+    }
+    if (result->out_of_memory) {
+        printf("Compile Error: out of memory\n");
+    }
+}
+
+void free_compile_result(CompileResult* result) {
+    free(result->program.code);
+    free(result->program.constants);
+    free(result->errors);
+    free_parse_result(&result->parse);
+    memset(result, 0, sizeof(CompileResult));
+}
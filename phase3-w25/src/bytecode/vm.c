@@ -0,0 +1,142 @@
+/* vm.c */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../include/bytecode.h"
+
+// Stack machine for compiled programs. Values are longs; arithmetic wraps
+// around instead of overflowing.
+
+// n! for n >= 66 has 64 factors of 2, so it wraps to 0
+static long factorial(long n) {
+    if (n >= 66) {
+        return 0;
+    }
+    unsigned long product = 1;
+    for (long i = 2; i <= n; i++) {
+        product *= (unsigned long)i;
+    }
+    return (long)product;
+}
+
+// Run a program that compiled without errors, printing its output and
+// any runtime error to `out`. Returns 0 after a runtime error (division by
+// zero) or if memory runs out.
+int run_bytecode(const Bytecode* program, FILE* out) {
+    long* stack = malloc((program->max_stack + 1) * sizeof(long));
+    long* slots = calloc(program->slots + 1, sizeof(long));
+    if (!stack || !slots) {
+        fprintf(out, "Runtime Error: out of memory\n");
+        free(stack);
+        free(slots);
+        return 0;
+    }
+
+    const int* code = program->code;
+    long* top = stack;      // One past the top of the stack
+    int pc = 0;
+    int ok = 1;
+    for (;;) {
+        switch ((Opcode)code[pc++]) {
+            case BC_PUSH:
+                *top++ = code[pc++];
+                break;
+            case BC_CONSTANT:
+                *top++ = program->constants[code[pc++]];
+                break;
+            case BC_LOAD:
+                *top++ = slots[code[pc++]];
+                break;
+            case BC_STORE:
+                slots[code[pc++]] = *--top;
+                break;
+            case BC_POP:
+                top--;
+                break;
+            case BC_ADD:
+                top--;
+                top[-1] = (long)((unsigned long)top[-1] + (unsigned long)top[0]);
+                break;
+            case BC_SUB:
+                top--;
+                top[-1] = (long)((unsigned long)top[-1] - (unsigned long)top[0]);
+                break;
+            case BC_MUL:
+                top--;
+                top[-1] = (long)((unsigned long)top[-1] * (unsigned long)top[0]);
+                break;
+            case BC_DIV:
+                top--;
+                if (top[0] == 0) {
+                    fprintf(out, "Runtime Error: division by zero\n");
+                    ok = 0;
+                    goto done;
+                }
+                // The one quotient that overflows wraps to the dividend
+                top[-1] = top[0] == -1 ? (long)(0 - (unsigned long)top[-1]) : top[-1] / top[0];
+                break;
+            case BC_EQ:
+                top--;
+                top[-1] = top[-1] == top[0];
+                break;
+            case BC_LT:
+                top--;
+                top[-1] = top[-1] < top[0];
+                break;
+            case BC_LE:
+                top--;
+                top[-1] = top[-1] <= top[0];
+                break;
+            case BC_GT:
+                top--;
+                top[-1] = top[-1] > top[0];
+                break;
+            case BC_GE:
+                top--;
+                top[-1] = top[-1] >= top[0];
+                break;
+            case BC_FACTORIAL:
+                top[-1] = factorial(top[-1]);
+                break;
+            case BC_PRINT:
+                fprintf(out, "%ld\n", *--top);
+                break;
+            case BC_JUMP:
+                pc = code[pc];
+                break;
+            case BC_JUMP_IF_ZERO:
+                pc = *--top == 0 ? code[pc] : pc + 1;
+                break;
+            case BC_HALT:
+                goto done;
+        }
+    }
+
+done:
+    free(stack);
+    free(slots);
+    return ok;
+}
+
+// Mnemonic of each instruction, and whether it takes an operand
+static const struct {
+    const char* name;
+    int has_operand;
+} opcode_info[] = {
+    {"PUSH", 1},     {"CONSTANT", 1}, {"LOAD", 1}, {"STORE", 1}, {"POP", 0},
+    {"ADD", 0},      {"SUB", 0},      {"MUL", 0},  {"DIV", 0},   {"EQ", 0},
+    {"LT", 0},       {"LE", 0},       {"GT", 0},   {"GE", 0},    {"FACTORIAL", 0},
+    {"PRINT", 0},    {"JUMP", 1},     {"JUMP_IF_ZERO", 1},       {"HALT", 0},
+};
+
+// Print a program one instruction per line, for debugging
+void print_bytecode(const Bytecode* program) {
+    for (int pc = 0; pc < program->count; pc++) {
+        Opcode op = (Opcode)program->code[pc];
+        printf("%6d  %s", pc, opcode_info[op].name);
+        if (opcode_info[op].has_operand) {
+            printf(" %d", program->code[++pc]);
+        }
+        printf("\n");
+    }
+}
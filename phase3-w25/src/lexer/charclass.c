@@ -0,0 +1,304 @@
+/* charclass.c */
+#include <stddef.h>
+
+#include "../../include/charclass.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHARCLASS_X86 1
+#include <immintrin.h>
+#endif
+
+#define S CC_SPACE
+#define D (CC_DIGIT | CC_IDENT)
+#define A (CC_ALPHA | CC_IDENT)
+
+// One row per 16 byte values; bytes 0x80-0xFF belong to no class
+const unsigned char lexer_char_class[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, S, S, 0, 0, 0, 0, 0,    // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    // 0x10
+    S, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    // 0x20  ' '
+    D, D, D, D, D, D, D, D, D, D, 0, 0, 0, 0, 0, 0,    // 0x30  0-9
+    0, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,    // 0x40  A-O
+    A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, A,    // 0x50  P-Z _
+    0, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,    // 0x60  a-o
+    A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, 0,    // 0x70  p-z
+};
+
+#undef S
+#undef D
+#undef A
+
+// Scalar implementations: one table lookup per byte. Also used for the
+// tail of the buffer where a full vector load would run past `end`.
+
+static const char* scan_class_scalar(const char* p, const char* end, int cls) {
+    while (p < end && char_is(*p, cls)) {
+        p++;
+    }
+    return p;
+}
+
+static const char* scan_digits_scalar(const char* p, const char* end) {
+    return scan_class_scalar(p, end, CC_DIGIT);
+}
+
+static const char* scan_ident_scalar(const char* p, const char* end) {
+    return scan_class_scalar(p, end, CC_IDENT);
+}
+
+static const char* scan_space_scalar(const char* p, const char* end) {
+    return scan_class_scalar(p, end, CC_SPACE);
+}
+
+static int count_newlines_scalar(const char* p, const char* end) {
+    int count = 0;
+    for (; p < end; p++) {
+        count += *p == '\n';
+    }
+    return count;
+}
+
+static int* find_newlines_scalar(const char* p, const char* end, int base, int* out) {
+    for (const char* q = p; q < end; q++) {
+        if (*q == '\n') {
+            *out++ = base + (int)(q - p);
+        }
+    }
+    return out;
+}
+
+#ifdef CHARCLASS_X86
+
+// Byte-wise lo <= v <= hi (unsigned), as an all-ones/all-zeros mask
+__attribute__((target("sse2")))
+static inline __m128i in_range_sse2(__m128i v, char lo, char hi) {
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8((char)(hi - lo))), d);
+}
+
+__attribute__((target("sse2")))
+static inline unsigned digit_mask_sse2(__m128i v) {
+    return (unsigned)_mm_movemask_epi8(in_range_sse2(v, '0', '9'));
+}
+
+__attribute__((target("sse2")))
+static inline unsigned ident_mask_sse2(__m128i v) {
+    // Setting bit 0x20 folds 'A'-'Z' onto 'a'-'z' and maps no other byte there
+    __m128i letter = in_range_sse2(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+    __m128i digit = in_range_sse2(v, '0', '9');
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, digit), under));
+}
+
+__attribute__((target("sse2")))
+static const char* scan_digits_sse2(const char* p, const char* end) {
+    while (end - p >= 16) {
+        unsigned mask = digit_mask_sse2(_mm_loadu_si128((const __m128i*)p));
+        if (mask != 0xFFFF) {
+            return p + __builtin_ctz(~mask);
+        }
+        p += 16;
+    }
+    return scan_digits_scalar(p, end);
+}
+
+__attribute__((target("sse2")))
+static const char* scan_ident_sse2(const char* p, const char* end) {
+    while (end - p >= 16) {
+        unsigned mask = ident_mask_sse2(_mm_loadu_si128((const __m128i*)p));
+        if (mask != 0xFFFF) {
+            return p + __builtin_ctz(~mask);
+        }
+        p += 16;
+    }
+    return scan_ident_scalar(p, end);
+}
+
+__attribute__((target("sse2")))
+static inline unsigned space_mask_sse2(__m128i v) {
+    __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                              _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                                           _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+    return (unsigned)_mm_movemask_epi8(ws);
+}
+
+__attribute__((target("sse2")))
+static const char* scan_space_sse2(const char* p, const char* end) {
+    while (end - p >= 16) {
+        unsigned mask = space_mask_sse2(_mm_loadu_si128((const __m128i*)p));
+        if (mask != 0xFFFF) {
+            return p + __builtin_ctz(~mask);
+        }
+        p += 16;
+    }
+    return scan_space_scalar(p, end);
+}
+
+__attribute__((target("sse2")))
+static inline unsigned newline_mask_sse2(const char* p) {
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+}
+
+__attribute__((target("sse2")))
+static int count_newlines_sse2(const char* p, const char* end) {
+    int count = 0;
+    while (end - p >= 16) {
+        count += __builtin_popcount(newline_mask_sse2(p));
+        p += 16;
+    }
+    return count + count_newlines_scalar(p, end);
+}
+
+__attribute__((target("sse2")))
+static int* find_newlines_sse2(const char* p, const char* end, int base, int* out) {
+    const char* start = p;
+    while (end - p >= 16) {
+        unsigned mask = newline_mask_sse2(p);
+        while (mask) {
+            *out++ = base + (int)(p - start) + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+        p += 16;
+    }
+    return find_newlines_scalar(p, end, base + (int)(p - start), out);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i in_range_avx2(__m256i v, char lo, char hi) {
+    __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8((char)(hi - lo))), d);
+}
+
+__attribute__((target("avx2")))
+static const char* scan_digits_avx2(const char* p, const char* end) {
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(in_range_avx2(v, '0', '9'));
+        if (mask != 0xFFFFFFFFu) {
+            return p + __builtin_ctz(~mask);
+        }
+        p += 32;
+    }
+    return scan_digits_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* scan_ident_avx2(const char* p, const char* end) {
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        __m256i letter = in_range_avx2(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+        __m256i digit = in_range_avx2(v, '0', '9');
+        __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_or_si256(letter, digit), under));
+        if (mask != 0xFFFFFFFFu) {
+            return p + __builtin_ctz(~mask);
+        }
+        p += 32;
+    }
+    return scan_ident_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* scan_space_avx2(const char* p, const char* end) {
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+                                                     _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(ws);
+        if (mask != 0xFFFFFFFFu) {
+            return p + __builtin_ctz(~mask);
+        }
+        p += 32;
+    }
+    return scan_space_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned newline_mask_avx2(const char* p) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)p);
+    return (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+}
+
+__attribute__((target("avx2")))
+static int count_newlines_avx2(const char* p, const char* end) {
+    int count = 0;
+    while (end - p >= 32) {
+        count += __builtin_popcount(newline_mask_avx2(p));
+        p += 32;
+    }
+    return count + count_newlines_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static int* find_newlines_avx2(const char* p, const char* end, int base, int* out) {
+    const char* start = p;
+    while (end - p >= 32) {
+        unsigned mask = newline_mask_avx2(p);
+        while (mask) {
+            *out++ = base + (int)(p - start) + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+        p += 32;
+    }
+    return find_newlines_sse2(p, end, base + (int)(p - start), out);
+}
+
+#endif /* CHARCLASS_X86 */
+
+// Selected implementations. Default to scalar until the CPU is checked.
+static const char* (*digits_impl)(const char*, const char*) = scan_digits_scalar;
+static const char* (*ident_impl)(const char*, const char*) = scan_ident_scalar;
+static const char* (*space_impl)(const char*, const char*) = scan_space_scalar;
+static int (*count_newlines_impl)(const char*, const char*) = count_newlines_scalar;
+static int* (*find_newlines_impl)(const char*, const char*, int, int*) = find_newlines_scalar;
+static const char* impl_name = "scalar";
+
+#ifdef CHARCLASS_X86
+// Runs once before main(), so the pointers never change while lexing
+__attribute__((constructor))
+static void charclass_select_impl(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        digits_impl = scan_digits_avx2;
+        ident_impl = scan_ident_avx2;
+        space_impl = scan_space_avx2;
+        count_newlines_impl = count_newlines_avx2;
+        find_newlines_impl = find_newlines_avx2;
+        impl_name = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        digits_impl = scan_digits_sse2;
+        ident_impl = scan_ident_sse2;
+        space_impl = scan_space_sse2;
+        count_newlines_impl = count_newlines_sse2;
+        find_newlines_impl = find_newlines_sse2;
+        impl_name = "sse2";
+    }
+}
+#endif
+
+const char* scan_digits(const char* p, const char* end) {
+    return digits_impl(p, end);
+}
+
+const char* scan_ident(const char* p, const char* end) {
+    return ident_impl(p, end);
+}
+
+const char* scan_space(const char* p, const char* end) {
+    return space_impl(p, end);
+}
+
+int count_newlines(const char* p, const char* end) {
+    return count_newlines_impl(p, end);
+}
+
+int* find_newlines(const char* p, const char* end, int base, int* out) {
+    return find_newlines_impl(p, end, base, out);
+}
+
+const char* charclass_impl_name(void) {
+    return impl_name;
+}
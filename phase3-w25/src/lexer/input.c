@@ -0,0 +1,228 @@
+/* input.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define INPUT_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../../include/tokens.h"
+#include "../../include/lexer.h"
+#include "../../include/input.h"
+
+// Fallback: read the whole file into a heap buffer. Gives up once the
+// file turns out to be INT_MAX bytes or more.
+static int input_read_whole(InputFile* file, const char* path) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        return 0;
+    }
+
+    int capacity = 4096;
+    int length = 0;
+    char* data = malloc(capacity);
+    size_t got;
+    while (data && (got = fread(data + length, 1, capacity - length, in)) > 0) {
+        length += (int)got;
+        if (length == capacity) {
+            if (capacity == INT_MAX) {
+                free(data);
+                data = NULL;
+                file->too_large = 1;
+                break;
+            }
+            int grown = capacity > INT_MAX / 2 ? INT_MAX : capacity * 2;
+            char* bigger = realloc(data, grown);
+            if (!bigger) {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = bigger;
+            capacity = grown;
+        }
+    }
+    fclose(in);
+
+    if (!data) {
+        return 0;
+    }
+    file->data = data;
+    file->length = length;
+    file->mapped = 0;
+    return 1;
+}
+
+// Map a file into memory without copying it. Returns 1 on success, 0 on
+// error or if the file is too large (see InputFile).
+int input_open(InputFile* file, const char* path) {
+    file->data = NULL;
+    file->length = 0;
+    file->mapped = 0;
+    file->too_large = 0;
+
+#ifdef INPUT_HAVE_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+
+    // Lengths and token offsets are ints: do not let the length wrap
+    if (S_ISREG(st.st_mode) && st.st_size >= INT_MAX) {
+        close(fd);
+        file->too_large = 1;
+        return 0;
+    }
+
+    // Empty files cannot be mapped; regular reads handle those and pipes
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            return 0;
+        }
+        madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+        file->data = data;
+        file->length = (int)st.st_size;
+        file->mapped = 1;
+        return 1;
+    }
+    close(fd);
+#endif
+
+    return input_read_whole(file, path);
+}
+
+void input_close(InputFile* file) {
+    if (!file->data) {
+        return;
+    }
+#ifdef INPUT_HAVE_MMAP
+    if (file->mapped) {
+        munmap((void*)file->data, (size_t)file->length);
+    }
+    else
+#endif
+    {
+        free((void*)file->data);
+    }
+    file->data = NULL;
+    file->length = 0;
+}
+
+int input_stream_open(InputStream* stream, const char* path, int window_size) {
+    memset(stream, 0, sizeof(InputStream));
+    stream->file = fopen(path, "rb");
+    if (!stream->file) {
+        return 0;
+    }
+    stream->capacity = window_size > 0 ? window_size : 64 * 1024;
+    stream->window = malloc(stream->capacity);
+    stream->strings = string_table_new();
+    if (!stream->window || !stream->strings) {
+        input_stream_close(stream);
+        return 0;
+    }
+    lexer_init_buffer(&stream->lexer, stream->window, 0);
+    stream->lexer.strings = stream->strings;
+    return 1;
+}
+
+void input_stream_close(InputStream* stream) {
+    if (stream->file) {
+        fclose(stream->file);
+    }
+    free(stream->window);
+    free_string_table(stream->strings);
+    stream->file = NULL;
+    stream->window = NULL;
+    stream->strings = NULL;
+}
+
+// Drop the bytes the lexer has consumed, read more of the file and expose
+// the complete lines of the window to the lexer. Returns 0 on error.
+static int input_stream_refill(InputStream* stream) {
+    Lexer* lexer = &stream->lexer;
+    int consumed = lexer->position;
+
+    memmove(stream->window, stream->window + consumed, stream->filled - consumed);
+    stream->filled -= consumed;
+    stream->base += consumed;
+
+    for (;;) {
+        if (stream->filled == stream->capacity) {
+            // A single line fills the whole window: make room for the rest,
+            // as long as its length still fits an int
+            if (stream->capacity == INT_MAX) {
+                stream->too_large = 1;
+                return 0;
+            }
+            int grown = stream->capacity > INT_MAX / 2 ? INT_MAX : stream->capacity * 2;
+            char* bigger = realloc(stream->window, grown);
+            if (!bigger) {
+                return 0;
+            }
+            stream->window = bigger;
+            stream->capacity = grown;
+        }
+
+        size_t got = fread(stream->window + stream->filled, 1,
+                           stream->capacity - stream->filled, stream->file);
+        stream->filled += (int)got;
+        if (got == 0) {
+            if (ferror(stream->file)) {
+                return 0;
+            }
+            stream->at_eof = 1;
+        }
+
+        // Lex up to and including the last newline, or everything at EOF
+        int lexable = stream->filled;
+        if (!stream->at_eof) {
+            while (lexable > 0 && stream->window[lexable - 1] != '\n') {
+                lexable--;
+            }
+        }
+        if (lexable > 0 || stream->at_eof) {
+            // Keep the previous token type across chunks
+            lexer->source = stream->window;
+            lexer->length = lexable;
+            lexer->position = 0;
+            return 1;
+        }
+    }
+}
+
+int input_stream_next(InputStream* stream, Token* token) {
+    for (;;) {
+        TokenType last_token_type = stream->lexer.last_token_type;
+        *token = get_next_token(&stream->lexer);
+        if (stream->lexer.out_of_memory) {
+            return -1;
+        }
+        if (token->type != TOKEN_EOF) {
+            return 1;
+        }
+
+        // The end of a chunk is not a real token: keep the previous type so
+        // the consecutive-operator check works across chunks
+        stream->lexer.last_token_type = last_token_type;
+        if (stream->at_eof && stream->lexer.length == stream->filled) {
+            return 0;
+        }
+        if (!input_stream_refill(stream)) {
+            return -1;
+        }
+    }
+}
@@ -0,0 +1,134 @@
+/* intern.c */
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/intern.h"
+
+// FNV-1a
+static unsigned hash_name(const char* text, int length) {
+    unsigned hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+StringTable* string_table_new(void) {
+    StringTable* table = calloc(1, sizeof(StringTable));
+    if (!table) {
+        return NULL;
+    }
+    table->slot_count = 64;
+    table->slots = calloc(table->slot_count, sizeof(int));
+    if (!table->slots) {
+        free(table);
+        return NULL;
+    }
+    return table;
+}
+
+void free_string_table(StringTable* table) {
+    if (!table) {
+        return;
+    }
+    free(table->chars);
+    free(table->name_offsets);
+    free(table->name_lengths);
+    free(table->name_hashes);
+    free(table->slots);
+    free(table);
+}
+
+// Double the hash table and reinsert every name
+static int grow_slots(StringTable* table) {
+    int slot_count = table->slot_count * 2;
+    int* slots = calloc(slot_count, sizeof(int));
+    if (!slots) {
+        return 0;
+    }
+    for (int id = 0; id < table->count; id++) {
+        unsigned slot = table->name_hashes[id] & (slot_count - 1);
+        while (slots[slot]) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        slots[slot] = id + 1;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slot_count = slot_count;
+    return 1;
+}
+
+// Make room for one more name of `length` characters
+static int reserve_name(StringTable* table, int length) {
+    if (table->count == table->capacity) {
+        int capacity = table->capacity ? table->capacity * 2 : 64;
+        int* offsets = realloc(table->name_offsets, capacity * sizeof(int));
+        if (offsets) table->name_offsets = offsets;
+        int* lengths = realloc(table->name_lengths, capacity * sizeof(int));
+        if (lengths) table->name_lengths = lengths;
+        unsigned* hashes = realloc(table->name_hashes, capacity * sizeof(unsigned));
+        if (hashes) table->name_hashes = hashes;
+        if (!offsets || !lengths || !hashes) {
+            return 0;
+        }
+        table->capacity = capacity;
+    }
+    if (table->chars_used + length + 1 > table->chars_capacity) {
+        int capacity = table->chars_capacity ? table->chars_capacity : 1024;
+        while (capacity < table->chars_used + length + 1) {
+            capacity *= 2;
+        }
+        char* chars = realloc(table->chars, capacity);
+        if (!chars) {
+            return 0;
+        }
+        table->chars = chars;
+        table->chars_capacity = capacity;
+    }
+    // Keep the hash table at most half full
+    if ((table->count + 1) * 2 > table->slot_count && !grow_slots(table)) {
+        return 0;
+    }
+    return 1;
+}
+
+int string_table_intern(StringTable* table, const char* text, int length) {
+    unsigned hash = hash_name(text, length);
+    unsigned slot = hash & (table->slot_count - 1);
+    while (table->slots[slot]) {
+        int id = table->slots[slot] - 1;
+        if (table->name_hashes[id] == hash && table->name_lengths[id] == length &&
+            memcmp(table->chars + table->name_offsets[id], text, length) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & (table->slot_count - 1);
+    }
+
+    if (!reserve_name(table, length)) {
+        return -1;
+    }
+    // The hash table may have been resized: find the free slot again
+    slot = hash & (table->slot_count - 1);
+    while (table->slots[slot]) {
+        slot = (slot + 1) & (table->slot_count - 1);
+    }
+
+    int id = table->count++;
+    table->name_offsets[id] = table->chars_used;
+    table->name_lengths[id] = length;
+    table->name_hashes[id] = hash;
+    memcpy(table->chars + table->chars_used, text, length);
+    table->chars[table->chars_used + length] = '\0';
+    table->chars_used += length + 1;
+    table->slots[slot] = id + 1;
+    return id;
+}
+
+const char* string_table_name(const StringTable* table, int id) {
+    return table->chars + table->name_offsets[id];
+}
+
+int string_table_length(const StringTable* table, int id) {
+    return table->name_lengths[id];
+}
@@ -0,0 +1,204 @@
+/* lex_parallel.c */
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../../include/tokens.h"
+#include "../../include/lexer.h"
+
+// Inputs smaller than this are not worth splitting
+#define PARALLEL_LEX_MIN_SEGMENT (64 * 1024)
+
+typedef struct {
+    const char* data;
+    int start;              // First byte of the segment
+    int end;                // One past the last byte of the segment
+    TokenStream* tokens;    // Tokens of the segment, EOF token dropped
+} LexSegment;
+
+static void* lex_segment(void* arg) {
+    LexSegment* segment = arg;
+    segment->tokens = token_stream_new((segment->end - segment->start) / 4 + 16);
+    if (!segment->tokens) {
+        return NULL;
+    }
+    segment->tokens->strings = string_table_new();
+    if (!segment->tokens->strings) {
+        free_token_stream(segment->tokens);
+        segment->tokens = NULL;
+        return NULL;
+    }
+
+    // Offsets stay absolute because the lexer runs over the whole buffer,
+    // bounded at the end of the segment
+    Lexer lexer;
+    lexer_resume(&lexer, segment->data, segment->end, segment->start, TOKEN_EOF);
+    lexer.strings = segment->tokens->strings;
+    for (;;) {
+        Token token = get_next_token(&lexer);
+        if (token.type == TOKEN_EOF) {
+            break;
+        }
+        if (lexer.out_of_memory || !token_stream_push(segment->tokens, token)) {
+            free_token_stream(segment->tokens);
+            segment->tokens = NULL;
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Each segment was lexed as if nothing came before it, so only the
+// consecutive-operator check can differ from a serial pass. Redo it from
+// the start of the segment until a token comes out unchanged.
+static void fix_segment_start(TokenStream* tokens, int index, TokenType last_token_type) {
+    for (; index < tokens->count; index++) {
+        int is_operator = tokens->types[index] == TOKEN_OPERATOR ||
+                          tokens->errors[index] == ERROR_CONSECUTIVE_OPERATORS;
+        if (!is_operator) {
+            return;
+        }
+
+        TokenType type = TOKEN_OPERATOR;
+        ErrorType error = ERROR_NONE;
+        if (last_token_type == TOKEN_OPERATOR) {
+            type = TOKEN_ERROR;
+            error = ERROR_CONSECUTIVE_OPERATORS;
+        }
+        if (tokens->types[index] == type) {
+            return;
+        }
+        tokens->types[index] = (unsigned char)type;
+        tokens->errors[index] = (unsigned char)error;
+        last_token_type = type;
+    }
+}
+
+// Move a segment's names into the joined stream's string table and
+// renumber the ids of its tokens, which start at index `at`
+static int merge_segment_names(TokenStream* stream, int at, const StringTable* names) {
+    int* remap = malloc((names->count + 1) * sizeof(int));
+    if (!remap) {
+        return 0;
+    }
+    for (int id = 0; id < names->count; id++) {
+        remap[id] = string_table_intern(stream->strings, string_table_name(names, id),
+                                        string_table_length(names, id));
+        if (remap[id] < 0) {
+            free(remap);
+            return 0;
+        }
+    }
+    for (int i = at; i < stream->count; i++) {
+        if (stream->ids[i] >= 0) {
+            stream->ids[i] = remap[stream->ids[i]];
+        }
+    }
+    free(remap);
+    return 1;
+}
+
+// Lex a buffer on several threads. The buffer is cut into `threads`
+// segments at newline boundaries (no token spans a newline), each segment
+// is lexed on its own thread and the results are joined in order. Falls
+// back to tokenize_buffer() for small inputs. Returns NULL on failure.
+TokenStream* tokenize_parallel(const char* data, int length, int threads) {
+    if (threads > length / PARALLEL_LEX_MIN_SEGMENT) {
+        threads = length / PARALLEL_LEX_MIN_SEGMENT;
+    }
+    if (threads <= 1) {
+        return tokenize_buffer(data, length);
+    }
+
+    LexSegment* segments = calloc(threads, sizeof(LexSegment));
+    pthread_t* workers = calloc(threads, sizeof(pthread_t));
+    if (!segments || !workers) {
+        free(segments);
+        free(workers);
+        return NULL;
+    }
+
+    // Cut just after the first newline at or past each even split point
+    int count = 0;
+    int start = 0;
+    for (int i = 1; i <= threads && start < length; i++) {
+        int end = length;
+        if (i < threads) {
+            int split = (int)((long long)length * i / threads);
+            if (split < start) {
+                split = start;
+            }
+            const char* newline = memchr(data + split, '\n', length - split);
+            end = newline ? (int)(newline - data) + 1 : length;
+        }
+        segments[count].data = data;
+        segments[count].start = start;
+        segments[count].end = end;
+        count++;
+        start = end;
+    }
+
+    int started = 0;
+    for (; started < count; started++) {
+        if (pthread_create(&workers[started], NULL, lex_segment, &segments[started]) != 0) {
+            break;
+        }
+    }
+    // Lex whatever could not get its own thread here
+    for (int i = started; i < count; i++) {
+        lex_segment(&segments[i]);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    // Stitch the segments together and append the EOF token
+    int total = 1;
+    int ok = 1;
+    for (int i = 0; i < count; i++) {
+        if (!segments[i].tokens) {
+            ok = 0;
+        } else {
+            total += segments[i].tokens->count;
+        }
+    }
+    TokenStream* stream = ok ? token_stream_new(total) : NULL;
+    if (stream) {
+        stream->strings = string_table_new();
+    }
+    if (stream && stream->strings) {
+        for (int i = 0; i < count && stream; i++) {
+            TokenStream* part = segments[i].tokens;
+            int at = stream->count;
+            memcpy(stream->types + at, part->types, part->count * sizeof(unsigned char));
+            memcpy(stream->offsets + at, part->offsets, part->count * sizeof(int));
+            memcpy(stream->lengths + at, part->lengths, part->count * sizeof(int));
+            memcpy(stream->errors + at, part->errors, part->count * sizeof(unsigned char));
+            memcpy(stream->ids + at, part->ids, part->count * sizeof(int));
+            memcpy(stream->ops + at, part->ops, part->count * sizeof(unsigned char));
+            stream->count += part->count;
+            if (at > 0) {
+                fix_segment_start(stream, at, (TokenType)stream->types[at - 1]);
+            }
+            if (!merge_segment_names(stream, at, part->strings)) {
+                free_token_stream(stream);
+                stream = NULL;
+            }
+        }
+        Token eof = {TOKEN_EOF, length, 0, ERROR_NONE, -1, OP_NONE};
+        if (stream && !token_stream_push(stream, eof)) {
+            free_token_stream(stream);
+            stream = NULL;
+        }
+    } else if (stream) {
+        free_token_stream(stream);
+        stream = NULL;
+    }
+
+    for (int i = 0; i < count; i++) {
+        free_token_stream(segments[i].tokens);
+    }
+    free(segments);
+    free(workers);
+    return stream;
+}
@@ -0,0 +1,140 @@
+/* lex_pipeline.c */
+#include <stdlib.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "../../include/tokens.h"
+#include "../../include/lexer.h"
+
+// Ring size in tokens (a power of two), and how many tokens the lexer
+// writes before publishing them, so the two threads do not trade the
+// cache line holding `head` on every token
+#define PIPELINE_RING_SIZE 4096
+#define PIPELINE_BATCH 64
+
+// Spins before a waiting thread yields its core
+#define PIPELINE_SPINS 256
+
+// The lexer thread is the only writer of `head` and the slots, the parser
+// the only writer of `tail`. Both counters only grow; slot i lives at
+// i % PIPELINE_RING_SIZE. Each sits on its own cache line.
+struct LexerPipeline {
+    _Alignas(64) atomic_uint head;      // Tokens published by the lexer
+    _Alignas(64) atomic_uint tail;      // Tokens taken by the parser
+    _Alignas(64) atomic_int closed;     // The parser stopped reading
+    atomic_int failed;                  // The lexer ran out of memory
+    Token slots[PIPELINE_RING_SIZE];
+    Lexer lexer;
+    pthread_t thread;
+};
+
+static void wait_a_little(int* spins) {
+    if (++*spins > PIPELINE_SPINS) {
+        sched_yield();
+    }
+}
+
+static void* lex_into_ring(void* arg) {
+    LexerPipeline* pipeline = arg;
+    unsigned head = 0;
+    unsigned published = 0;
+    Token token;
+    do {
+        // Back-pressure: wait while the ring is full
+        unsigned tail = atomic_load_explicit(&pipeline->tail, memory_order_acquire);
+        int spins = 0;
+        while (head - tail == PIPELINE_RING_SIZE) {
+            if (published != head) {
+                atomic_store_explicit(&pipeline->head, head, memory_order_release);
+                published = head;
+            }
+            if (atomic_load_explicit(&pipeline->closed, memory_order_acquire)) {
+                return NULL;
+            }
+            wait_a_little(&spins);
+            tail = atomic_load_explicit(&pipeline->tail, memory_order_acquire);
+        }
+
+        token = get_next_token(&pipeline->lexer);
+        if (pipeline->lexer.out_of_memory) {
+            // End the input here; the parser learns why from `failed`
+            atomic_store_explicit(&pipeline->failed, 1, memory_order_relaxed);
+            token.type = TOKEN_EOF;
+        }
+        pipeline->slots[head % PIPELINE_RING_SIZE] = token;
+        head++;
+        if (head - published >= PIPELINE_BATCH || token.type == TOKEN_EOF) {
+            atomic_store_explicit(&pipeline->head, head, memory_order_release);
+            published = head;
+        }
+    } while (token.type != TOKEN_EOF);
+    return NULL;
+}
+
+// Start lexing `length` bytes of `data` on a thread of its own. Names are
+// interned into `strings`, which only that thread touches until
+// lexer_pipeline_stop(). Returns NULL if memory or threads run out.
+LexerPipeline* lexer_pipeline_start(const char* data, int length, StringTable* strings) {
+    LexerPipeline* pipeline = aligned_alloc(64, sizeof(LexerPipeline));
+    if (!pipeline) {
+        return NULL;
+    }
+    atomic_init(&pipeline->head, 0);
+    atomic_init(&pipeline->tail, 0);
+    atomic_init(&pipeline->closed, 0);
+    atomic_init(&pipeline->failed, 0);
+    lexer_init_buffer(&pipeline->lexer, data, length);
+    pipeline->lexer.strings = strings;
+    if (pthread_create(&pipeline->thread, NULL, lex_into_ring, pipeline) != 0) {
+        free(pipeline);
+        return NULL;
+    }
+    return pipeline;
+}
+
+// Move every token the lexer has published to the end of `stream`,
+// waiting until there is at least one. Returns how many were moved, or 0
+// if memory runs out here or in the lexer thread.
+int lexer_pipeline_read(LexerPipeline* pipeline, TokenStream* stream) {
+    unsigned tail = atomic_load_explicit(&pipeline->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&pipeline->head, memory_order_acquire);
+    int spins = 0;
+    while (head == tail) {
+        wait_a_little(&spins);
+        head = atomic_load_explicit(&pipeline->head, memory_order_acquire);
+    }
+    // Set before the head that publishes the token it ended the input with
+    if (atomic_load_explicit(&pipeline->failed, memory_order_relaxed)) {
+        return 0;
+    }
+
+    int n = (int)(head - tail);
+    if (!token_stream_reserve(stream, stream->count + n)) {
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        const Token* token = &pipeline->slots[(tail + i) % PIPELINE_RING_SIZE];
+        int k = stream->count + i;
+        stream->types[k] = (unsigned char)token->type;
+        stream->offsets[k] = token->offset;
+        stream->lengths[k] = token->length;
+        stream->errors[k] = (unsigned char)token->error;
+        stream->ids[k] = token->id;
+        stream->ops[k] = (unsigned char)token->op;
+    }
+    stream->count += n;
+    atomic_store_explicit(&pipeline->tail, head, memory_order_release);
+    return n;
+}
+
+// Stop the lexer thread, whether or not it reached the end of the input,
+// and free the pipeline
+void lexer_pipeline_stop(LexerPipeline* pipeline) {
+    if (!pipeline) {
+        return;
+    }
+    atomic_store_explicit(&pipeline->closed, 1, memory_order_release);
+    pthread_join(pipeline->thread, NULL);
+    free(pipeline);
+}
@@ -1,39 +1,53 @@
 /* lexer.c */
 #include <stdio.h>
 #include <stdlib.h>
-#include <ctype.h>
 #include <string.h>
 
 #include "../../include/tokens.h"
 #include "../../include/lexer.h"
+#include "../../include/charclass.h"
 
-static int current_line = 1;
-static int current_column = 1; // Column tracking
-static char last_token_type = 'x';
-
-// Keywords table
-static struct {
-    const char* word;
-    TokenType type;
-} keywords[] = {
-    {"if", TOKEN_IF},
-    {"while", TOKEN_WHILE},
-    {"factorial", TOKEN_FACT},
-    {"int", TOKEN_INT},
-    {"print", TOKEN_PRINT},
-    {"repeat", TOKEN_REPEAT},
-    {"until", TOKEN_UNTIL}
-};
-
-static int is_keyword(const char* word) {
-    for (int i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
-        if (strcmp(word, keywords[i].word) == 0) {
-            return keywords[i].type;
-        }
+// Keyword hash table and operator DFA, generated by tools/gen_lexer_tables.c
+#include "lexer_tables.h"
+
+// One hash and at most one compare per identifier
+static int is_keyword(const char* word, int length) {
+    if (length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH) {
+        return 0;
+    }
+    unsigned slot = KEYWORD_HASH(word, length);
+    if (keyword_table[slot].length == length &&
+        memcmp(word, keyword_table[slot].word, length) == 0) {
+        return keyword_table[slot].type;
     }
     return 0;
 }
 
+// Pointer to the first character of the token inside the source buffer
+const char* token_lexeme(const char* source, Token token) {
+    return source + token.offset;
+}
+
+// Compare the token text against a NUL-terminated string
+int token_lexeme_equals(const char* source, Token token, const char* text) {
+    return strncmp(source + token.offset, text, token.length) == 0 &&
+           text[token.length] == '\0';
+}
+
+// Copy the token text into a NUL-terminated buffer (for diagnostics)
+void token_copy_lexeme(const char* source, Token token, char* buffer, int size) {
+    if (size <= 0) {
+        return;
+    }
+    if (token.type == TOKEN_EOF) {
+        snprintf(buffer, size, "EOF");
+        return;
+    }
+    int length = token.length < size - 1 ? token.length : size - 1;
+    memcpy(buffer, source + token.offset, length);
+    buffer[length] = '\0';
+}
+
 void print_error(ErrorType error, int line, int column, const char* lexeme) {
     printf("Lexical Error at line %d, column %d: ", line, column);
     switch(error) {
@@ -57,9 +71,15 @@ void print_error(ErrorType error, int line, int column, const char* lexeme) {
     }
 }
 
-void print_token(Token token) {
+void print_token(LineIndex* lines, Token token) {
+    const char* source = lines->source;
+    int line, column;
+    line_index_position(lines, token.offset, &line, &column);
+
     if (token.error != ERROR_NONE) {
-        print_error(token.error, token.line, token.column, token.lexeme);
+        char lexeme[100];
+        token_copy_lexeme(source, token, lexeme, sizeof(lexeme));
+        print_error(token.error, line, column, lexeme);
         return;
     }
 
@@ -85,145 +105,243 @@ void print_token(Token token) {
         case TOKEN_EOF:        printf("EOF"); break;
         default:               printf("UNKNOWN");
     }
-    printf(" | Lexeme: '%s' | Line: %d\n", token.lexeme, token.line);
+    printf(" | Lexeme: '%.*s' | Line: %d\n", token.length, token_lexeme(source, token), line);
 }
 
-Token get_next_token(const char* input, int* pos) {
-    Token token = {TOKEN_ERROR, "", current_line, current_column, ERROR_NONE};
+// Scan one token starting at the lexer's current position
+static Token scan_token(Lexer* lexer) {
+    const char* input = lexer->source;
+    const char* end = input + lexer->length;
+    Token token = {TOKEN_ERROR, 0, 0, ERROR_NONE, -1, OP_NONE};
     char c;
 
-    // Skip whitespace and track line numbers
-    while ((c = input[*pos]) != '\0' && (c == ' ' || c == '\n' || c == '\t')) {
-        if (c == '\n') {
-            current_line++;
-            current_column = 1; // Reset column on newline
-        } 
-        else {
-            current_column++; // Add 1 to column for whitespace
-        }
-        (*pos)++;
-    }
+    // Skip whitespace. Line numbers are not tracked here: diagnostics
+    // recover them from the offset with a LineIndex.
+    const char* p = scan_space(input + lexer->position, end);
+    lexer->position = (int)(p - input);
+    token.offset = lexer->position;
 
-    if (input[*pos] == '\0') {
+    if (lexer->position >= lexer->length) {
         token.type = TOKEN_EOF;
-        strcpy(token.lexeme, "EOF");
         return token;
     }
 
-    int token_column = current_column;
-
-    c = input[*pos];
+    c = input[lexer->position];
 
     // Handle numbers
-    if (isdigit(c)) {
-        int i = 0;
-        do {
-            token.lexeme[i++] = c;
-            current_column++; // Update column
-            (*pos)++;
-            c = input[*pos];
-        } while (isdigit(c) && i < sizeof(token.lexeme) - 1);
-
-        token.lexeme[i] = '\0';
+    if (char_is(c, CC_DIGIT)) {
+        p = scan_digits(p + 1, end);
+        lexer->position = (int)(p - input);
+
+        token.length = lexer->position - token.offset;
         token.type = TOKEN_NUMBER;
-        token.column = token_column; // Assign starting column
         return token;
     }
 
     // Handle identifiers and keywords
-    if (isalpha(c) || c == '_') {
-        int i = 0;
-        do {
-            token.lexeme[i++] = c;
-            (*pos)++;
-            current_column++; // Update column
-            c = input[*pos];
-        } while ((isalnum(c) || c == '_') && i < sizeof(token.lexeme) - 1);
+    if (char_is(c, CC_ALPHA)) {
+        p = scan_ident(p + 1, end);
+        lexer->position = (int)(p - input);
 
-        token.lexeme[i] = '\0';
+        token.length = lexer->position - token.offset;
 
         // Check if it's a keyword
-        TokenType keyword_type = is_keyword(token.lexeme);
+        TokenType keyword_type = is_keyword(input + token.offset, token.length);
         if (keyword_type) {
             token.type = keyword_type;
         } else {
             token.type = TOKEN_IDENTIFIER;
+            if (lexer->strings) {
+                token.id = string_table_intern(lexer->strings, input + token.offset, token.length);
+                if (token.id < 0) {
+                    lexer->out_of_memory = 1;
+                }
+            }
         }
-        token.column = token_column;
         return token;
     }
 
-    // Handle operators and delimiters
-    (*pos)++;
-    token.column = token_column; // Assign starting column
-    token.lexeme[0] = c;
-    token.lexeme[1] = '\0';
-    char d;
-
-    switch(c) {
-        case '+': case '-': case '*': case '/':
-            if (last_token_type == 'o') {
-                token.error = ERROR_CONSECUTIVE_OPERATORS;
-                return token;
-            }
-            token.type = TOKEN_OPERATOR;
-            last_token_type = 'o';
-            break;
-        case '=':
-            d = input[*pos];
-            if (d == '='){
-                token.type = TOKEN_COMPARE;
-                token.lexeme[1] = d;
-                token.lexeme[2] = '\0';
-                (*pos)++;
-                current_column++; // Update column
-                break;
-            }
-            token.type = TOKEN_EQUALS;
-            break;
-        case '<':
-            token.type = TOKEN_COMPARE;
-            d = input[*pos];
-            if (d == '='){
-                token.lexeme[1] = d;
-                token.lexeme[2] = '\0';
-                (*pos)++;
-                current_column++; // Update column
-            }
-            break;
-        case '>':
-            token.type = TOKEN_COMPARE;
-            d = input[*pos];
-            if (d == '='){
-                token.lexeme[1] = d;
-                token.lexeme[2] = '\0';
-                (*pos)++;
-                current_column++; // Update column
-            }
-            break;
-        case ';':
-            token.type = TOKEN_SEMICOLON;
-            break;
-        case '(':
-            token.type = TOKEN_LPAREN;
-            break;
-        case ')':
-            token.type = TOKEN_RPAREN;
-            break;
-        case '{':
-            token.type = TOKEN_LBRACE;
-            break;
-        case '}':
-            token.type = TOKEN_RBRACE;
-            break;
-        default:
-            token.error = ERROR_INVALID_CHAR;
+    // Handle operators and delimiters: run the operator DFA and keep the
+    // longest match
+    int state = OP_STATE_START;
+    int length = 0;
+    for (int i = lexer->position; i < lexer->length; i++) {
+        state = op_transition[state][op_char_class[(unsigned char)input[i]]];
+        if (state == OP_STATE_DEAD) {
             break;
+        }
+        if (op_accept[state] != TOKEN_ERROR) {
+            token.type = op_accept[state];
+            token.op = op_kind[state];
+            length = i - lexer->position + 1;
+        }
+    }
+
+    // Invalid characters are consumed as one-character error tokens
+    if (length == 0) {
+        length = 1;
+        token.error = ERROR_INVALID_CHAR;
+    }
+    else if (token.type == TOKEN_OPERATOR && lexer->last_token_type == TOKEN_OPERATOR) {
+        token.type = TOKEN_ERROR;
+        token.error = ERROR_CONSECUTIVE_OPERATORS;
     }
 
+    token.length = length;
+    lexer->position += length;
     return token;
 }
 
+// Prepare a lexer to tokenize `length` bytes of `data` from the beginning.
+// The data does not need to be NUL-terminated (e.g. a memory-mapped file).
+void lexer_init_buffer(Lexer* lexer, const char* data, int length) {
+    lexer->source = data;
+    lexer->length = length;
+    lexer->position = 0;
+    lexer->last_token_type = TOKEN_EOF;
+    lexer->strings = NULL;
+    lexer->out_of_memory = 0;
+}
+
+// Resume lexing at a token boundary. The lexer's only state besides the
+// position is the type of the token before it, so this restarts it exactly
+// where an earlier pass over the same bytes left off.
+void lexer_resume(Lexer* lexer, const char* data, int length, int position,
+                  TokenType last_token_type) {
+    lexer->source = data;
+    lexer->length = length;
+    lexer->position = position;
+    lexer->last_token_type = last_token_type;
+    lexer->strings = NULL;
+    lexer->out_of_memory = 0;
+}
+
+// Prepare a lexer to tokenize the NUL-terminated string `input`
+void lexer_init(Lexer* lexer, const char* input) {
+    lexer_init_buffer(lexer, input, (int)strlen(input));
+}
+
+Token get_next_token(Lexer* lexer) {
+    Token token = scan_token(lexer);
+    lexer->last_token_type = token.type;
+    return token;
+}
+
+// Grow every array of the stream to hold at least `needed` tokens
+int token_stream_reserve(TokenStream* stream, int needed) {
+    if (needed <= stream->capacity) {
+        return 1;
+    }
+    int capacity = stream->capacity ? stream->capacity : 64;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+
+    unsigned char* types = realloc(stream->types, capacity * sizeof(unsigned char));
+    if (types) stream->types = types;
+    int* offsets = realloc(stream->offsets, capacity * sizeof(int));
+    if (offsets) stream->offsets = offsets;
+    int* lengths = realloc(stream->lengths, capacity * sizeof(int));
+    if (lengths) stream->lengths = lengths;
+    unsigned char* errors = realloc(stream->errors, capacity * sizeof(unsigned char));
+    if (errors) stream->errors = errors;
+    int* ids = realloc(stream->ids, capacity * sizeof(int));
+    if (ids) stream->ids = ids;
+    unsigned char* ops = realloc(stream->ops, capacity * sizeof(unsigned char));
+    if (ops) stream->ops = ops;
+
+    if (!types || !offsets || !lengths || !errors || !ids || !ops) {
+        return 0;
+    }
+    stream->capacity = capacity;
+    return 1;
+}
+
+// Create an empty stream with room for `capacity` tokens
+TokenStream* token_stream_new(int capacity) {
+    TokenStream* stream = calloc(1, sizeof(TokenStream));
+    if (stream && !token_stream_reserve(stream, capacity > 0 ? capacity : 1)) {
+        free_token_stream(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+// Append a token to the stream. Returns 0 if memory runs out.
+int token_stream_push(TokenStream* stream, Token token) {
+    if (stream->count == stream->capacity &&
+        !token_stream_reserve(stream, stream->count + 1)) {
+        return 0;
+    }
+    int i = stream->count++;
+    stream->types[i] = (unsigned char)token.type;
+    stream->offsets[i] = token.offset;
+    stream->lengths[i] = token.length;
+    stream->errors[i] = (unsigned char)token.error;
+    stream->ids[i] = token.id;
+    stream->ops[i] = (unsigned char)token.op;
+    return 1;
+}
+
+// Lex a whole buffer in one pass. Returns NULL if memory runs out.
+TokenStream* tokenize_buffer(const char* data, int length) {
+    // Rough guess of one token per 4 bytes of source to avoid regrowing
+    TokenStream* stream = token_stream_new(length / 4 + 16);
+    if (!stream) {
+        return NULL;
+    }
+    stream->strings = string_table_new();
+    if (!stream->strings) {
+        free_token_stream(stream);
+        return NULL;
+    }
+
+    Lexer lexer;
+    lexer_init_buffer(&lexer, data, length);
+    lexer.strings = stream->strings;
+    Token token;
+    do {
+        token = get_next_token(&lexer);
+        if (lexer.out_of_memory || !token_stream_push(stream, token)) {
+            free_token_stream(stream);
+            return NULL;
+        }
+    } while (token.type != TOKEN_EOF);
+
+    return stream;
+}
+
+// Lex a whole NUL-terminated string in one pass
+TokenStream* tokenize_all(const char* input) {
+    return tokenize_buffer(input, (int)strlen(input));
+}
+
+// Gather token `index` of the stream back into a Token
+Token token_at(const TokenStream* stream, int index) {
+    Token token;
+    token.type = (TokenType)stream->types[index];
+    token.offset = stream->offsets[index];
+    token.length = stream->lengths[index];
+    token.error = (ErrorType)stream->errors[index];
+    token.id = stream->ids[index];
+    token.op = (OperatorKind)stream->ops[index];
+    return token;
+}
+
+void free_token_stream(TokenStream* stream) {
+    if (!stream) {
+        return;
+    }
+    free(stream->types);
+    free(stream->offsets);
+    free(stream->lengths);
+    free(stream->errors);
+    free(stream->ids);
+    free(stream->ops);
+    free_string_table(stream->strings);
+    free(stream);
+}
+
 // int main() {
 //     const char *input = "int x = 123;\n"   // Basic declaration and number
 //                        "test_var = 456;\n"  // Identifier and assignment
@@ -234,12 +352,15 @@ Token get_next_token(const char* input, int* pos) {
 //                        "}";
 //
 //     printf("Analyzing input:\n%s\n\n", input);
-//     int position = 0;
+//     Lexer lexer;
+//     lexer_init(&lexer, input);
+//     LineIndex lines;
+//     line_index_init(&lines, input);
 //     Token token;
 //
 //     do {
-//         token = get_next_token(input, &position);
-//         print_token(token);
+//         token = get_next_token(&lexer);
+//         print_token(&lines, token);
 //     } while (token.type != TOKEN_EOF);
 //
 //     return 0;
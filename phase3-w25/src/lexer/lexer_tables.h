@@ -0,0 +1,119 @@
+/* lexer_tables.h */
+// Generated by tools/gen_lexer_tables.c -- do not edit by hand.
+#ifndef LEXER_TABLES_H
+#define LEXER_TABLES_H
+
+#include "../../include/tokens.h"
+
+// Keyword perfect hash: slot = (first * 1 + last * 7 + length) & 7
+#define KEYWORD_HASH_SIZE 8
+#define KEYWORD_HASH_MUL_FIRST 1
+#define KEYWORD_HASH_MUL_LAST 7
+#define KEYWORD_MIN_LENGTH 2
+#define KEYWORD_MAX_LENGTH 9
+#define KEYWORD_HASH(word, length) (((unsigned char)(word)[0] * (KEYWORD_HASH_MUL_FIRST) + (unsigned char)(word)[(length) - 1] * (KEYWORD_HASH_MUL_LAST) + (unsigned)(length)) & (KEYWORD_HASH_SIZE - 1))
+
+static const struct {
+    const char* word;
+    int length;
+    TokenType type;
+} keyword_table[KEYWORD_HASH_SIZE] = {
+    {"int", 3, TOKEN_INT},
+    {"print", 5, TOKEN_PRINT},
+    {"", 0, TOKEN_ERROR},
+    {"factorial", 9, TOKEN_FACT},
+    {"repeat", 6, TOKEN_REPEAT},
+    {"if", 2, TOKEN_IF},
+    {"until", 5, TOKEN_UNTIL},
+    {"while", 5, TOKEN_WHILE},
+};
+
+// Operator DFA: op_transition[state][op_char_class[c]] gives the next
+// state (OP_STATE_DEAD stops the match), op_accept[state] the token
+// type recognized so far (TOKEN_ERROR if none) and op_kind[state] its
+// operator kind.
+#define OP_CLASS_COUNT 13
+#define OP_STATE_COUNT 17
+#define OP_STATE_DEAD 0
+#define OP_STATE_START 1
+
+static const unsigned char op_char_class[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 9, 10, 3, 1, 0, 2, 0, 4,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 8, 6, 5, 7, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 11, 0, 12, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static const unsigned char op_transition[OP_STATE_COUNT][OP_CLASS_COUNT] = {
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 2, 3, 4, 5, 6, 8, 10, 12, 13, 14, 15, 16},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 7, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 9, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 11, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+};
+
+static const TokenType op_accept[OP_STATE_COUNT] = {
+    TOKEN_ERROR,
+    TOKEN_ERROR,
+    TOKEN_OPERATOR,
+    TOKEN_OPERATOR,
+    TOKEN_OPERATOR,
+    TOKEN_OPERATOR,
+    TOKEN_EQUALS,
+    TOKEN_COMPARE,
+    TOKEN_COMPARE,
+    TOKEN_COMPARE,
+    TOKEN_COMPARE,
+    TOKEN_COMPARE,
+    TOKEN_SEMICOLON,
+    TOKEN_LPAREN,
+    TOKEN_RPAREN,
+    TOKEN_LBRACE,
+    TOKEN_RBRACE,
+};
+
+static const OperatorKind op_kind[OP_STATE_COUNT] = {
+    OP_NONE,
+    OP_NONE,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_NONE,
+    OP_EQ,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_NONE,
+    OP_NONE,
+    OP_NONE,
+    OP_NONE,
+    OP_NONE,
+};
+
+#endif /* LEXER_TABLES_H */
@@ -0,0 +1,85 @@
+/* line_index.c */
+#include <stdlib.h>
+
+#include "../../include/charclass.h"
+#include "../../include/line_index.h"
+
+void line_index_init(LineIndex* index, const char* source) {
+    index->source = source;
+    index->starts = NULL;
+    index->count = 0;
+    index->capacity = 0;
+    index->scanned = 0;
+}
+
+void line_index_free(LineIndex* index) {
+    free(index->starts);
+    line_index_init(index, index->source);
+}
+
+// Record the start of every line that begins at or before `offset`
+static int line_index_extend(LineIndex* index, int offset) {
+    if (!index->starts) {
+        index->capacity = 64;
+        index->starts = malloc(index->capacity * sizeof(int));
+        if (!index->starts) {
+            return 0;
+        }
+        index->starts[0] = 0;
+        index->count = 1;
+    }
+    if (offset <= index->scanned) {
+        return 1;
+    }
+
+    const char* from = index->source + index->scanned;
+    const char* to = index->source + offset;
+    int needed = index->count + count_newlines(from, to);
+    if (needed > index->capacity) {
+        int capacity = index->capacity;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        int* starts = realloc(index->starts, capacity * sizeof(int));
+        if (!starts) {
+            return 0;
+        }
+        index->starts = starts;
+        index->capacity = capacity;
+    }
+
+    // A line starts right after each newline
+    int* first = index->starts + index->count;
+    int* last = find_newlines(from, to, index->scanned + 1, first);
+    index->count += (int)(last - first);
+    index->scanned = offset;
+    return 1;
+}
+
+void line_index_position(LineIndex* index, int offset, int* line, int* column) {
+    if (!line_index_extend(index, offset)) {
+        *line = 0;
+        *column = 0;
+        return;
+    }
+
+    // Binary search for the last line starting at or before offset
+    int low = 0;
+    int high = index->count - 1;
+    while (low < high) {
+        int mid = low + (high - low + 1) / 2;
+        if (index->starts[mid] <= offset) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    *line = low + 1;
+    *column = offset - index->starts[low] + 1;
+}
+
+int line_index_line(LineIndex* index, int offset) {
+    int line, column;
+    line_index_position(index, offset, &line, &column);
+    return line;
+}
@@ -0,0 +1,129 @@
+/* relex.c */
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/tokens.h"
+#include "../../include/lexer.h"
+
+// Index of the first token that ends at or after `offset`. Tokens are
+// sorted and do not overlap, so their end offsets are sorted too.
+static int first_token_ending_at_or_after(const TokenStream* tokens, int offset) {
+    int low = 0;
+    int high = tokens->count - 1; // The EOF token ends at the end of input
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (tokens->offsets[mid] + tokens->lengths[mid] >= offset) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+int relex_edit(const TokenStream* old_tokens, const char* new_source, int new_length,
+               TextEdit edit, TokenDelta* delta) {
+    int shift = edit.inserted_length - (edit.end - edit.start);
+
+    // A token that touches the edit may merge with the new text ("ab" + "c"
+    // or "<" + "="), so restart right after the token before it. Tokens
+    // that end earlier are followed by unchanged whitespace and cannot be
+    // affected.
+    int first = first_token_ending_at_or_after(old_tokens, edit.start);
+    int restart = 0;
+    TokenType last_token_type = TOKEN_EOF;
+    if (first > 0) {
+        restart = old_tokens->offsets[first - 1] + old_tokens->lengths[first - 1];
+        last_token_type = (TokenType)old_tokens->types[first - 1];
+    }
+
+    TokenStream* inserted = token_stream_new(16);
+    if (!inserted) {
+        return 0;
+    }
+
+    // New identifiers go into the old stream's string table, so ids in the
+    // delta are consistent with the tokens they are spliced between
+    Lexer lexer;
+    lexer_resume(&lexer, new_source, new_length, restart, last_token_type);
+    lexer.strings = old_tokens->strings;
+
+    // Once a new token past the edit matches the old token at the same
+    // (shifted) offset, the lexer is back in the state it had in the old
+    // pass and the rest of the old stream is still valid
+    int inserted_end = edit.start + edit.inserted_length;
+    int resync = first;
+    for (;;) {
+        Token token = get_next_token(&lexer);
+        if (lexer.out_of_memory) {
+            free_token_stream(inserted);
+            return 0;
+        }
+        if (token.offset >= inserted_end) {
+            int old_offset = token.offset - shift;
+            while (resync < old_tokens->count && old_tokens->offsets[resync] < old_offset) {
+                resync++;
+            }
+            if (resync < old_tokens->count &&
+                old_tokens->offsets[resync] == old_offset &&
+                old_tokens->types[resync] == token.type &&
+                old_tokens->lengths[resync] == token.length &&
+                old_tokens->errors[resync] == token.error) {
+                break;
+            }
+        }
+        if (!token_stream_push(inserted, token)) {
+            free_token_stream(inserted);
+            return 0;
+        }
+        if (token.type == TOKEN_EOF) {
+            resync = old_tokens->count;
+            break;
+        }
+    }
+
+    delta->first = first;
+    delta->removed = resync - first;
+    delta->inserted = inserted;
+    delta->offset_shift = shift;
+    return 1;
+}
+
+// Splice a delta into the stream it was computed from. The tokens after
+// the replaced range are moved and shifted in place.
+int token_stream_apply(TokenStream* stream, const TokenDelta* delta) {
+    int added = delta->inserted->count;
+    int tail_from = delta->first + delta->removed;
+    int tail_to = delta->first + added;
+    int tail = stream->count - tail_from;
+
+    if (!token_stream_reserve(stream, tail_to + tail)) {
+        return 0;
+    }
+
+    memmove(stream->types + tail_to, stream->types + tail_from, tail * sizeof(unsigned char));
+    memmove(stream->offsets + tail_to, stream->offsets + tail_from, tail * sizeof(int));
+    memmove(stream->lengths + tail_to, stream->lengths + tail_from, tail * sizeof(int));
+    memmove(stream->errors + tail_to, stream->errors + tail_from, tail * sizeof(unsigned char));
+    memmove(stream->ids + tail_to, stream->ids + tail_from, tail * sizeof(int));
+    memmove(stream->ops + tail_to, stream->ops + tail_from, tail * sizeof(unsigned char));
+    if (delta->offset_shift) {
+        for (int i = tail_to; i < tail_to + tail; i++) {
+            stream->offsets[i] += delta->offset_shift;
+        }
+    }
+
+    memcpy(stream->types + delta->first, delta->inserted->types, added * sizeof(unsigned char));
+    memcpy(stream->offsets + delta->first, delta->inserted->offsets, added * sizeof(int));
+    memcpy(stream->lengths + delta->first, delta->inserted->lengths, added * sizeof(int));
+    memcpy(stream->errors + delta->first, delta->inserted->errors, added * sizeof(unsigned char));
+    memcpy(stream->ids + delta->first, delta->inserted->ids, added * sizeof(int));
+    memcpy(stream->ops + delta->first, delta->inserted->ops, added * sizeof(unsigned char));
+    stream->count = tail_to + tail;
+    return 1;
+}
+
+void free_token_delta(TokenDelta* delta) {
+    free_token_stream(delta->inserted);
+    delta->inserted = NULL;
+}
@@ -0,0 +1,72 @@
+/* arena.c */
+#include <stdlib.h>
+
+#include "../../include/arena.h"
+
+#define ARENA_DEFAULT_BLOCK (64 * 1024)
+#define ARENA_ALIGN (sizeof(max_align_t))
+
+void arena_init(Arena* arena, size_t block_size) {
+    arena->head = NULL;
+    arena->current = NULL;
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK;
+}
+
+static ArenaBlock* arena_new_block(size_t size) {
+    ArenaBlock* block = malloc(sizeof(ArenaBlock) + size);
+    if (block) {
+        block->next = NULL;
+        block->size = size;
+        block->used = 0;
+    }
+    return block;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    // Move on to blocks kept by arena_reset before allocating new ones
+    ArenaBlock* block = arena->current;
+    while (block && block->size - block->used < size) {
+        if (!block->next) {
+            break;
+        }
+        block = block->next;
+    }
+
+    if (!block || block->size - block->used < size) {
+        ArenaBlock* fresh = arena_new_block(size > arena->block_size ? size : arena->block_size);
+        if (!fresh) {
+            return NULL;
+        }
+        if (block) {
+            block->next = fresh;
+        } else {
+            arena->head = fresh;
+        }
+        block = fresh;
+    }
+
+    arena->current = block;
+    void* p = (char*)block->data + block->used;
+    block->used += size;
+    return p;
+}
+
+void arena_reset(Arena* arena) {
+    for (ArenaBlock* block = arena->head; block; block = block->next) {
+        block->used = 0;
+    }
+    arena->current = arena->head;
+}
+
+void arena_free(Arena* arena) {
+    ArenaBlock* block = arena->head;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+    arena->current = NULL;
+}
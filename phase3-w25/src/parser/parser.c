@@ -1,689 +1,2613 @@
-/* parser.c */
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include "../../include/parser.h"
-#include "../../include/lexer.h"
-#include "../../include/tokens.h"
-
-// TODO 1: Add more parsing function declarations for:
-// - if statements: if (condition) { ... }
-// - while loops: while (condition) { ... }
-// - repeat-until: repeat { ... } until (condition)
-// - print statements: print x;
-// - blocks: { statement1; statement2; }
-// - factorial function: factorial(x)
-
-// Current token being processed
-static Token current_token;
-static int position = 0;
-static const char *source;
-
-static void parse_error(ParseError error, Token token)
-{
-    // If your Token structure has a column field, you can enable the line below.
-    printf("Parse Error at line %d, column %d: ", token.line, token.column);
-    //printf("Parse Error at line %d: ", token.line);
-    switch (error)
-    {
-    case PARSE_ERROR_UNEXPECTED_TOKEN:
-        printf("Unexpected token '%s'\n", token.lexeme);
-        break;
-    case PARSE_ERROR_MISSING_SEMICOLON:
-        printf("Missing semicolon after '%s'\n", token.lexeme);
-        break;
-    case PARSE_ERROR_MISSING_IDENTIFIER:
-        printf("Expected identifier after '%s'\n", token.lexeme);
-        break;
-    case PARSE_ERROR_MISSING_EQUALS:
-        printf("Expected '=' after '%s'\n", token.lexeme);
-        break;
-    case PARSE_ERROR_INVALID_EXPRESSION:
-        printf("Invalid expression after '%s'\n", token.lexeme);
-        break;
-    case PARSE_ERROR_MISSING_PARENTHESIS:
-        printf("Expected parenthesis for line ended '%s'\n", token.lexeme);
-        break;
-    case PARSE_ERROR_BAD_PARENTHESIS:
-        printf("Expected alternative parenthesis for line ended '%s'\n", token.lexeme);
-        break;
-    case PARSE_ERROR_MISSING_CONDITION:
-        printf("Missing condition near '%s'\n", token.lexeme);
-        break;
-    case PARSE_ERROR_MISSING_BLOCK:
-        printf("Missing block braces near '%s'\n", token.lexeme);
-        break;
-    case PARSE_ERROR_INVALID_OPERATOR:
-        printf("Invalid operator '%s'\n", token.lexeme);
-        break;
-    case PARSE_ERROR_FUNCTION_CALL_ERROR:
-        printf("Function call error near '%s'\n", token.lexeme);
-        break;
-    case PARSE_ERROR_MISSING_UNTILS:
-        printf("Unexpected error near '%s', expected until\n", token.lexeme);
-        break;
-    default:
-        printf("Unknown error\n");
-    }
-}
-
-// Get next token
-static void advance(void)
-{
-    current_token = get_next_token(source, &position);
-    // For debugging purposes
-    //printf("Token: %s (Type: %d, Line: %d, Column: %d)\n",
-    //       current_token.lexeme, current_token.type, current_token.line, current_token.column);
-}
-
-// Create a new AST node
-static ASTNode *create_node(ASTNodeType type)
-{
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (node)
-    {
-        node->type = type;
-        node->token = current_token;
-        node->left = NULL;
-        node->right = NULL;
-    }
-    return node;
-}
-
-// Match current token with expected type
-static int match(TokenType type)
-{
-    return current_token.type == type;
-}
-
-// Expect a token type or error
-static void expect(TokenType type)
-{
-    if (match(type))
-    {
-        advance();
-    }
-    else
-    {
-        parse_error(PARSE_ERROR_UNEXPECTED_TOKEN, current_token);
-        //exit(1); // Or implement error recovery
-    }
-}
-
-// Forward declarations
-static ASTNode *parse_statement(void);
-
-// TODO 3: Add parsing functions for each new statement type
-static ASTNode* parse_if_statement(void);
-static ASTNode* parse_while_statement(void);
-static ASTNode* parse_repeat_statement(void);
-static ASTNode* parse_print_statement(void);
-static ASTNode* parse_block(void);// { ... }
-static ASTNode* parse_factorial(void);
-static ASTNode *parse_expression(void);
-static ASTNode *parse_expr_prec(int min_prec);
-
-
-// Parse if statement: if (x) {y}
-// UNTESTED
-static ASTNode *parse_if_statement(void)
-{
-
-    // the 'if' itself
-    ASTNode *node = create_node(AST_IF);
-    advance();
-
-    // Parenthesis handling done within functions
-    
-    node->left = parse_expr_prec(0);
-    
-    node->right = parse_block();
-
-    return node;
-}
-
-// Parse while statement: while (x) {y}
-// UNTESTED
-static ASTNode *parse_while_statement(void)
-{
-
-    // the 'while' itself
-    ASTNode *node = create_node(AST_WHILE);
-    advance();
-
-    // Parenthesis handling done within functions
-    
-    node->left = parse_expr_prec(0);
-    
-    node->right = parse_block();
-
-    return node;
-}
-
-// Parse factorial function: factorial(x) 
-/*
-IMPORTANT: I asked Dr. Acharya in class whether the factorial function
-should recursively build out a parse tree like:
-
-           fac
-    /   /   |   \   \
-   (   id   *  fac   )
-        |   / / | \ \
-        x  ( id * fac )
-             |   //|\\
-            x-1
-
-... and so on until x == 1,
-or whether it could simply be 
-
-            fac
-          /  |  \
-          (  x  )
-
-... with the multiplication being implied as the function's process.
-Dr. Acharya said the latter is sufficient. This code reflects that.
-*/
-static ASTNode *parse_factorial(void)
-{
-    ASTNode *node = create_node(AST_FACTORIAL);
-    advance(); // consume factorial
-
-    // '('
-    if (!match(TOKEN_LPAREN))
-    {
-        parse_error(PARSE_ERROR_MISSING_PARENTHESIS, current_token);
-        exit(1);
-    }
-    advance();
-
-    // 'x'
-    node->left = parse_expr_prec(0);
-
-    // ')'
-    if (!match(TOKEN_RPAREN))
-    {
-        parse_error(PARSE_ERROR_MISSING_PARENTHESIS, current_token);
-        exit(1);
-    }
-    
-    advance();
-    return node;
-
-}
-
-// parse 'repeat {x} until (y)'
-static ASTNode *parse_repeat_statement(void)
-{
-    // 'repeat'
-    ASTNode *node = create_node(AST_REPEAT);
-    advance();
-
-    // '{statements}'
-    node->left = parse_block();
-    
-    // 'until'
-    if (!match(TOKEN_UNTIL)) 
-    {
-        parse_error(PARSE_ERROR_MISSING_UNTILS, current_token);
-        exit(1);
-    }
-    advance(); 
-
-    // condition
-    node->right = parse_expr_prec(0);
-
-    return node;
-}
-
-// parse {code} blocks
-static ASTNode *parse_block(void) 
-{
-    
-    // `{`
-    if (!match(TOKEN_LBRACE)) 
-    {
-        parse_error(PARSE_ERROR_MISSING_BLOCK, current_token);
-        exit(1);
-    }
-    advance(); 
-
-    // one or more statements: following logic of parse_program()
-    ASTNode *block = create_node(AST_BLOCK);
-    ASTNode *curr = block;
-
-    while (!match(TOKEN_RBRACE) && !match(TOKEN_EOF)) 
-    {
-        curr->left = parse_statement();
-        if (!match(TOKEN_RBRACE) && !match(TOKEN_EOF)) 
-        {
-            curr->right = create_node(AST_BLOCK);
-            curr = curr->right;
-        }
-    }
-
-    // '}'
-    if (!match(TOKEN_RBRACE)) 
-    {
-        parse_error(PARSE_ERROR_MISSING_BLOCK, current_token);
-        exit(1);
-    }
-    advance();
-
-    return block;
-}
-
-// Parse variable declaration: int x;
-static ASTNode *parse_declaration(void)
-{
-    ASTNode *node = create_node(AST_VARDECL);
-    advance(); // consume 'int'
-
-    if (!match(TOKEN_IDENTIFIER))
-    {
-        parse_error(PARSE_ERROR_MISSING_IDENTIFIER, current_token);
-        // << EDIT: Added error recovery: Skip tokens until a semicolon or EOF is encountered
-        while (!match(TOKEN_SEMICOLON) && current_token.type != TOKEN_EOF) {
-            advance();
-        }
-        if (match(TOKEN_SEMICOLON)) {
-            advance();
-        }
-        return NULL;
-    }
-
-    node->token = current_token;
-    advance();
-
-    if (!match(TOKEN_SEMICOLON))
-    {
-        parse_error(PARSE_ERROR_MISSING_SEMICOLON, current_token);
-        // << EDIT: Added error recovery: Skip tokens until a semicolon or EOF is encountered
-        while (!match(TOKEN_SEMICOLON) && current_token.type != TOKEN_EOF) {
-            advance();
-        }
-        if (match(TOKEN_SEMICOLON)) {
-            advance();
-        }
-        return node;
-    }
-    advance();
-    return node;
-}
-
-// Parse assignment: x = 5;
-static ASTNode *parse_assignment(void)
-{
-    ASTNode *node = create_node(AST_ASSIGN);
-    node->left = create_node(AST_IDENTIFIER);
-    node->left->token = current_token;
-    advance();
-
-    if (!match(TOKEN_EQUALS))
-    {
-        parse_error(PARSE_ERROR_MISSING_EQUALS, current_token);
-        // << EDIT: Added error recovery: Skip tokens until a semicolon or EOF is encountered
-        while (!match(TOKEN_SEMICOLON) && current_token.type != TOKEN_EOF) {
-            advance();
-        }
-        if (match(TOKEN_SEMICOLON)) {
-            advance();
-        }
-        return NULL;
-    }
-    advance();
-
-    node->right = parse_expr_prec(0);
-
-    if (!match(TOKEN_SEMICOLON))
-    {
-        parse_error(PARSE_ERROR_MISSING_SEMICOLON, current_token);
-        // << EDIT: Added error recovery: Skip tokens until a semicolon or EOF is encountered
-        while (!match(TOKEN_SEMICOLON) && current_token.type != TOKEN_EOF) {
-            advance();
-        }
-        if (match(TOKEN_SEMICOLON)) {
-            advance();
-        }
-        return node;
-    }
-    advance();
-    return node;
-}
-
-// Parse print statements
-static ASTNode *parse_print_statement(void) {
-    ASTNode *node = create_node(AST_PRINT);
-    advance(); // consume the 'print' keyword
-    node->left = parse_expression();
-    if (!match(TOKEN_SEMICOLON))
-    {
-        parse_error(PARSE_ERROR_MISSING_SEMICOLON, current_token);
-        // << EDIT: Added error recovery: Skip tokens until a semicolon or EOF is encountered
-        while (!match(TOKEN_SEMICOLON) && current_token.type != TOKEN_EOF) {
-            advance();
-        }
-        if (match(TOKEN_SEMICOLON)) {
-            advance();
-        }
-        return node;
-    }
-    advance();
-    return node;
-}
-
-
-// Parse statement
-static ASTNode *parse_statement(void)
-{
-    if (match(TOKEN_INT))
-    {
-        return parse_declaration();
-    }
-    else if (match(TOKEN_IDENTIFIER))
-    {
-        return parse_assignment();
-    }
-    else if (match(TOKEN_IF)) 
-    {
-        return parse_if_statement();
-    }
-    else if (match(TOKEN_WHILE)) 
-    {
-        return parse_while_statement();
-    }
-    else if (match(TOKEN_FACT))
-    {
-        return parse_factorial();
-    }
-    else if (match(TOKEN_REPEAT))
-    {
-        return parse_repeat_statement();
-    }
-    else if (match(TOKEN_PRINT))
-    {
-        return parse_print_statement();
-    }
-    // TODO 4: Add cases for new statement types
-    // else if (match(TOKEN_REPEAT)) return parse_repeat_statement();
-    // else if (match(TOKEN_PRINT)) return parse_print_statement();
-    // ...
-
-    printf("Syntax Error: Unexpected token\n");
-    exit(1);
-}
-
-// Parse expression (currently only handles numbers and identifiers)
-
-// TODO 5: Implement expression parsing
-// Current expression parsing is basic. Need to implement:
-// - Binary operations (+-*/)
-// - Comparison operators (<, >, ==, etc.)
-// - Operator precedence
-// - Parentheses grouping
-// - Function calls
-
-static ASTNode *parse_expression(void)
-{
-    ASTNode *node;
-
-    if (match(TOKEN_LPAREN)) {
-        advance();
-        node = parse_expr_prec(0);
-        if (!match(TOKEN_RPAREN)) {
-            printf("Syntax Error: Expected ')' but found %s\n", node->token.lexeme);
-            exit(1);
-        }
-        advance();
-    }
-    else if (match(TOKEN_NUMBER))
-    {
-        node = create_node(AST_NUMBER);
-        advance();
-    }
-    else if (match(TOKEN_IDENTIFIER))
-    {
-        node = create_node(AST_IDENTIFIER);
-        advance();
-    }
-    else if (match(TOKEN_FACT))
-    {
-        node = parse_factorial();
-    }
-    else if (match(TOKEN_PRINT))
-    {
-        node = parse_print_statement();
-    }
-    else
-    {
-        printf("Syntax Error: Expected expression\n");
-        exit(1);
-    }
-
-    return node;
-}
-
-static int get_precedence(Token token)
-{
-    if ((token.type != TOKEN_OPERATOR) && (token.type != TOKEN_COMPARE))
-        return -1;
-    if (strcmp(token.lexeme, "==") == 0 || strcmp(token.lexeme, "!=") == 0 ||
-        strcmp(token.lexeme, "<") == 0 || strcmp(token.lexeme, ">") == 0 ||
-        strcmp(token.lexeme, "<=") == 0 || strcmp(token.lexeme, ">=") == 0)
-        return 1;
-    if (strcmp(token.lexeme, "+") == 0 || strcmp(token.lexeme, "-") == 0)
-        return 2;
-    if (strcmp(token.lexeme, "*") == 0 || strcmp(token.lexeme, "/") == 0)
-        return 3;
-    return -1;
-}
-
-static ASTNode *parse_expr_prec(int min_prec)
-{
-    ASTNode *left = parse_expression();
-
-    while (match(TOKEN_OPERATOR) || match(TOKEN_COMPARE))
-    {
-        int prec = get_precedence(current_token);
-        if (prec < min_prec)
-            break;
-
-        Token op = current_token;
-        advance();
-
-        ASTNode *right = parse_expr_prec(prec + 1);
-
-        ASTNode *binop_node = create_node(AST_BINOP);
-        binop_node->token = op;
-        binop_node->left = left;
-        binop_node->right = right;
-
-        left = binop_node;
-    }
-
-    return left;
-}
-
-// Parse program (multiple statements)
-static ASTNode *parse_program(void)
-{
-    ASTNode *program = create_node(AST_PROGRAM);
-    ASTNode *current = program;
-
-    while (!match(TOKEN_EOF))
-    {
-        current->left = parse_statement();
-        if (!match(TOKEN_EOF))
-        {
-            current->right = create_node(AST_PROGRAM);
-            current = current->right;
-        }
-    }
-
-    return program;
-}
-
-// Initialize parser
-void parser_init(const char *input)
-{
-    source = input;
-    position = 0;
-    advance(); // Get first token
-}
-
-// Main parse function
-ASTNode *parse(void)
-{
-    return parse_program();
-}
-
-// Print AST (for debugging)
-void print_ast(ASTNode *node, int level)
-{
-    if (!node)
-        return;
-
-    // Indent based on level
-    for (int i = 0; i < level; i++)
-        printf("  ");
-
-    // Print node info
-    switch (node->type)
-    {
-    case AST_PROGRAM:
-        printf("Program\n");
-        break;
-    case AST_VARDECL:
-        printf("VarDecl: %s\n", node->token.lexeme);
-        break;
-    case AST_ASSIGN:
-        printf("Assign\n");
-        break;
-    case AST_NUMBER:
-        printf("Number: %s\n", node->token.lexeme);
-        break;
-    case AST_IDENTIFIER:
-        printf("Identifier: %s\n", node->token.lexeme);
-        break;
-
-    // TODO 6: Add cases for new node types
-    case AST_IF: printf("If\n"); break;
-    case AST_WHILE: printf("While\n"); break;
-    case AST_REPEAT: printf("Repeat-Until\n"); break;
-    case AST_BLOCK: printf("Block\n"); break;
-    case AST_PRINT: printf("Print\n"); break;
-    case AST_FACTORIAL:
-        printf("Factorial of:\n");
-        break;
-    case AST_BINOP:
-        printf("BinaryOp: %s\n", node->token.lexeme);
-        break;
-    default:
-        printf("Unknown node type\n");
-    }
-
-    // Print children
-    print_ast(node->left, level + 1);
-    print_ast(node->right, level + 1);
-}
-
-// Free AST memory
-void free_ast(ASTNode *node)
-{
-    if (!node)
-        return;
-    free_ast(node->left);
-    free_ast(node->right);
-    free(node);
-}
-
-void test_case_1(void);
-void test_case_2(void);
-
-// Main function for testing
-// int main()
-// {
-//     // Test with both valid and invalid inputs
-//     const char *input = "int x;\n"   // Valid declaration
-//                         "x = 42;\n" // Valid assignment;
-//
-//                         // comment and uncomment out these lines at will
-//                         // to see how valid and invalid output proceed
-//                         "if (x <= 42) {\n"
-//                         "   y = 5;\n"
-//                         "   z = 6;\n"
-//                         "}\n"
-//                         "while (y == 5) {\n"
-//                         "   y = 6;\n"
-//                         "   x = z;\n"
-//                         "}\n"
-//                         "repeat {\n"
-//                         "   y = y + 2;\n"
-//                         "   x = x + 3;\n"
-//                         "} until (x > 10) \n";
-//     //"a = factorial(z - 1);\n"
-//     //"y = (x + 2) * 3;\n";
-//
-//
-//
-//     // TODO 8: Add more test cases and read from a file:
-//     /*
-//     const char *invalid_input = "int x;\n"
-//                                 "x = 42;\n"
-//                                 "int x;\n"
-//                                 "x = 42;"
-//                                 "if x == 42) {"
-//                                 "y = 5y;"
-//                                 "z = 6"
-//                                 "}"
-//                                 "int ;";
-// */
-//     printf("Parsing input:\n%s\n", input);
-//     parser_init(input);
-//     ASTNode *ast = parse();
-//
-//     printf("\nAbstract Syntax Tree:\n");
-//     print_ast(ast, 0);
-//
-//     // New: Perform semantic analysis after AST is created
-//     printf("\nPerforming Semantic Analysis...\n");
-//     int semanticResult = analyze_semantics(ast);
-//     if (semanticResult) {
-//         printf("Semantic analysis successful. No errors found.\n");
-//     } else {
-//         printf("Semantic analysis failed. Errors detected.\n");
-//     }
-//
-//     free_ast(ast);
-//
-//     test_case_1();
-//     test_case_2();
-//     return 0;
-// }
-//
-// void test_case_1(void) {
-//     // Valid case
-//     printf("\nTest case 1:\n");
-//     const char *input = "int x;\n x = 10;\n print x; if (x > 4) { x = 5; }";
-//     printf("Parsing input:\n%s\n", input);
-//     parser_init(input);
-//     ASTNode *ast = parse();
-//
-//     printf("\nAbstract Syntax Tree:\n");
-//     print_ast(ast, 0);
-//
-//     free_ast(ast);
-// }
-//
-// void test_case_2(void) {
-//     // Invalid case
-//     printf("\nTest case 2:\n");
-//     const char *input = "int x; print x + ;";
-//     printf("Parsing input:\n%s\n", input);
-//     parser_init(input);
-//     ASTNode *ast = parse();
-//
-//     printf("\nAbstract Syntax Tree:\n");
-//     print_ast(ast, 0);
-//
-//     free_ast(ast);
+/* parser.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../../include/parser.h"
+#include "../../include/lexer.h"
+#include "../../include/tokens.h"
+#include "../../include/charclass.h"
+
+// TODO 1: Add more parsing function declarations for:
+// - if statements: if (condition) { ... }
+// - while loops: while (condition) { ... }
+// - repeat-until: repeat { ... } until (condition)
+// - print statements: print x;
+// - blocks: { statement1; statement2; }
+// - factorial function: factorial(x)
+
+// Text of a parse error, printed after the position
+static void print_parse_error(const char *source, ParseError error, Token token)
+{
+    char lexeme[100];
+    token_copy_lexeme(source, token, lexeme, sizeof(lexeme));
+
+    switch (error)
+    {
+    case PARSE_ERROR_UNEXPECTED_TOKEN:
+        printf("Unexpected token '%s'\n", lexeme);
+        break;
+    case PARSE_ERROR_MISSING_SEMICOLON:
+        printf("Missing semicolon after '%s'\n", lexeme);
+        break;
+    case PARSE_ERROR_MISSING_IDENTIFIER:
+        printf("Expected identifier after '%s'\n", lexeme);
+        break;
+    case PARSE_ERROR_MISSING_EQUALS:
+        printf("Expected '=' after '%s'\n", lexeme);
+        break;
+    case PARSE_ERROR_INVALID_EXPRESSION:
+        printf("Invalid expression after '%s'\n", lexeme);
+        break;
+    case PARSE_ERROR_MISSING_PARENTHESIS:
+        printf("Expected parenthesis for line ended '%s'\n", lexeme);
+        break;
+    case PARSE_ERROR_BAD_PARENTHESIS:
+        printf("Expected alternative parenthesis for line ended '%s'\n", lexeme);
+        break;
+    case PARSE_ERROR_MISSING_CONDITION:
+        printf("Missing condition near '%s'\n", lexeme);
+        break;
+    case PARSE_ERROR_MISSING_BLOCK:
+        printf("Missing block braces near '%s'\n", lexeme);
+        break;
+    case PARSE_ERROR_INVALID_OPERATOR:
+        printf("Invalid operator '%s'\n", lexeme);
+        break;
+    case PARSE_ERROR_FUNCTION_CALL_ERROR:
+        printf("Function call error near '%s'\n", lexeme);
+        break;
+    case PARSE_ERROR_MISSING_UNTILS:
+        printf("Unexpected error near '%s', expected until\n", lexeme);
+        break;
+    default:
+        printf("Unknown error\n");
+    }
+}
+
+// Record an error at the current token. Only the first error of a
+// statement is kept; the rest usually follow from it.
+static void parse_error(Parser *p, ParseError error)
+{
+    if (p->panic)
+    {
+        return;
+    }
+    p->panic = 1;
+
+    ParseResult *result = &p->result;
+    if (result->diagnostic_count == result->diagnostic_capacity)
+    {
+        int capacity = result->diagnostic_capacity ? result->diagnostic_capacity * 2 : 8;
+        ParseDiagnostic *grown = realloc(result->diagnostics, capacity * sizeof(ParseDiagnostic));
+        if (!grown)
+        {
+            result->out_of_memory = 1;
+            return;
+        }
+        result->diagnostics = grown;
+        result->diagnostic_capacity = capacity;
+    }
+
+    ParseDiagnostic *diagnostic = &result->diagnostics[result->diagnostic_count++];
+    diagnostic->error = error;
+    diagnostic->token = p->current_token;
+    diagnostic->token_index = p->token_index;
+    diagnostic->unit = p->unit;
+    line_index_position(&p->lines, p->current_token.offset, &diagnostic->line, &diagnostic->column);
+}
+
+// Position of token `index` in the stream. Outside syntax-only mode the
+// stream holds every token, so this is the index itself.
+static inline int slot(Parser *p, int index)
+{
+    return index - p->token_base;
+}
+
+// Syntax-only mode: lex tokens into the window until it is full or the
+// input ends
+static void fill_window(Parser *p)
+{
+    TokenStream *window = p->tokens;
+    while (window->count < window->capacity)
+    {
+        Token token = get_next_token(&p->lexer);
+        if (p->lexer.out_of_memory)
+            p->result.out_of_memory = 1;
+        token_stream_push(window, token);
+        if (token.type == TOKEN_EOF)
+            break;
+    }
+}
+
+// Syntax-only mode: move the window past the tokens already read. The
+// current token is kept, since error recovery looks one token back.
+static void next_window(Parser *p)
+{
+    TokenStream *window = p->tokens;
+    Token last = token_at(window, window->count - 1);
+    p->token_base += window->count - 1;
+    window->count = 0;
+    token_stream_push(window, last);
+    fill_window(p);
+}
+
+// Pipelined mode: take the tokens the lexer thread has produced since the
+// last call, waiting for at least one. If memory runs out, the current
+// token becomes the end of the input.
+static void pull_tokens(Parser *p)
+{
+    if (!lexer_pipeline_read(p->pipeline, p->tokens))
+    {
+        p->result.out_of_memory = 1;
+        p->tokens->types[p->tokens->count - 1] = TOKEN_EOF;
+        p->token_index--;
+    }
+}
+
+// Get next token
+static void advance(Parser *p)
+{
+    // Stay on the EOF token once the end of the stream is reached
+    if (slot(p, p->token_index) < p->tokens->count - 1)
+    {
+        p->token_index++;
+    }
+    else if (p->syntax_only && p->current_token.type != TOKEN_EOF)
+    {
+        next_window(p);
+        p->token_index++;
+    }
+    else if (p->pipeline && p->current_token.type != TOKEN_EOF)
+    {
+        pull_tokens(p);
+        p->token_index++;
+    }
+    p->current_token = token_at(p->tokens, slot(p, p->token_index));
+    // For debugging purposes
+    //printf("Token: %.*s (Type: %d, Offset: %d)\n",
+    //       p->current_token.length, token_lexeme(p->source, p->current_token),
+    //       p->current_token.type, p->current_token.offset);
+}
+
+// Resize one array of a tree. Arena memory cannot be resized, so the
+// used part is copied to a new allocation and the old one is left to
+// the arena.
+static void *tree_grow(Arena *arena, void *items, size_t used, size_t size)
+{
+    if (!arena)
+    {
+        return realloc(items, size);
+    }
+    void *grown = arena_alloc(arena, size);
+    if (grown && used > 0)
+    {
+        memcpy(grown, items, used);
+    }
+    return grown;
+}
+
+// Grow the node arrays of a tree. Returns 0 if memory runs out.
+static int ast_reserve(AST *ast, int capacity)
+{
+    if (capacity <= ast->capacity)
+    {
+        return 1;
+    }
+    if (capacity < ast->capacity * 2)
+    {
+        capacity = ast->capacity * 2;
+    }
+    size_t used = ast->count;
+    unsigned char *kinds = tree_grow(ast->arena, ast->kinds, used * sizeof(unsigned char),
+                                     capacity * sizeof(unsigned char));
+    if (kinds) ast->kinds = kinds;
+    int *token_indices = tree_grow(ast->arena, ast->tokens, used * sizeof(int), capacity * sizeof(int));
+    if (token_indices) ast->tokens = token_indices;
+    int *starts = tree_grow(ast->arena, ast->starts, used * sizeof(int), capacity * sizeof(int));
+    if (starts) ast->starts = starts;
+    int *ends = tree_grow(ast->arena, ast->ends, used * sizeof(int), capacity * sizeof(int));
+    if (ends) ast->ends = ends;
+    NodeId *left = tree_grow(ast->arena, ast->left, used * sizeof(NodeId), capacity * sizeof(NodeId));
+    if (left) ast->left = left;
+    NodeId *right = tree_grow(ast->arena, ast->right, used * sizeof(NodeId), capacity * sizeof(NodeId));
+    if (right) ast->right = right;
+
+    if (!kinds || !token_indices || !starts || !ends || !left || !right)
+    {
+        return 0;
+    }
+    ast->capacity = capacity;
+    return 1;
+}
+
+// Grow the statement lists of a tree. Returns 0 if memory runs out.
+static int ast_reserve_lists(AST *ast, int capacity)
+{
+    if (capacity <= ast->list_capacity)
+    {
+        return 1;
+    }
+    if (capacity < ast->list_capacity * 2)
+    {
+        capacity = ast->list_capacity * 2;
+    }
+    NodeId *lists = tree_grow(ast->arena, ast->lists, ast->list_count * sizeof(NodeId),
+                              capacity * sizeof(NodeId));
+    if (!lists)
+    {
+        return 0;
+    }
+    ast->lists = lists;
+    ast->list_capacity = capacity;
+    return 1;
+}
+
+// Empty tree holding only the sentinel node 0
+static AST *ast_new(int capacity)
+{
+    AST *ast = calloc(1, sizeof(AST));
+    if (!ast || !ast_reserve(ast, capacity > 0 ? capacity : 1))
+    {
+        free_ast(ast);
+        return NULL;
+    }
+    ast->kinds[0] = AST_PROGRAM;
+    ast->tokens[0] = 0;
+    ast->starts[0] = 0;
+    ast->ends[0] = 0;
+    ast->left[0] = 0;
+    ast->right[0] = 0;
+    ast->count = 1;
+    return ast;
+}
+
+// Create a new AST node. Returns 0 if memory runs out.
+static NodeId create_node(Parser *p, ASTNodeType type)
+{
+    if (p->syntax_only)
+    {
+        return 0;
+    }
+    if (p->tree->count == p->tree->capacity && !ast_reserve(p->tree, p->tree->count + 1))
+    {
+        p->result.out_of_memory = 1;
+        return 0;
+    }
+    NodeId node = p->tree->count++;
+    p->tree->kinds[node] = (unsigned char)type;
+    p->tree->tokens[node] = p->token_index;
+    p->tree->starts[node] = p->token_index;
+    p->tree->ends[node] = p->token_index;
+    p->tree->left[node] = 0;
+    p->tree->right[node] = 0;
+    return node;
+}
+
+// Child setters. The node arrays may move while a child is parsed, so the
+// child is always parsed first and passed in, never assigned through
+// an element address taken beforehand. Writes to the sentinel are dropped.
+static void set_left(Parser *p, NodeId node, NodeId child)
+{
+    if (node)
+        p->tree->left[node] = child;
+}
+
+static void set_right(Parser *p, NodeId node, NodeId child)
+{
+    if (node)
+        p->tree->right[node] = child;
+}
+
+static void set_token(Parser *p, NodeId node, int index)
+{
+    if (node)
+        p->tree->tokens[node] = index;
+}
+
+// A node's span starts at its token unless moved back with set_start,
+// and ends where the parser stands when end_span is called
+static void set_start(Parser *p, NodeId node, int index)
+{
+    if (node)
+        p->tree->starts[node] = index;
+}
+
+static void end_span(Parser *p, NodeId node)
+{
+    if (node)
+        p->tree->ends[node] = p->token_index;
+}
+
+// Make room for `needed` ids in a growable id array. Returns 0 if memory
+// runs out.
+static int reserve_ids(NodeId **items, int *capacity, int needed)
+{
+    if (needed <= *capacity)
+    {
+        return 1;
+    }
+    int grown = *capacity * 2 > needed ? *capacity * 2 : needed;
+    NodeId *resized = realloc(*items, grown * sizeof(NodeId));
+    if (!resized)
+    {
+        return 0;
+    }
+    *items = resized;
+    *capacity = grown;
+    return 1;
+}
+
+// Add a parsed statement to the innermost open sequence. Empty statements
+// (left behind by error recovery) are not kept.
+static void push_statement(Parser *p, NodeId statement)
+{
+    if (!statement)
+    {
+        return;
+    }
+    if (!reserve_ids(&p->pending, &p->pending_capacity, p->pending_count + 1))
+    {
+        p->result.out_of_memory = 1;
+        return;
+    }
+    p->pending[p->pending_count++] = statement;
+}
+
+// Close a sequence whose statements were pushed since `base`: copy them
+// to the tree's list storage and point the sequence node at them
+static void end_sequence(Parser *p, NodeId sequence, int base)
+{
+    int n = p->pending_count - base;
+    p->pending_count = base;
+    if (!sequence)
+    {
+        return;
+    }
+    if (!ast_reserve_lists(p->tree, p->tree->list_count + n))
+    {
+        p->result.out_of_memory = 1;
+        return;
+    }
+    if (n > 0)
+    {
+        memcpy(p->tree->lists + p->tree->list_count, p->pending + base, n * sizeof(NodeId));
+    }
+    p->tree->left[sequence] = p->tree->list_count;
+    p->tree->right[sequence] = n;
+    p->tree->list_count += n;
+}
+
+// Hash of a shareable node's structure. Its children are shared already,
+// so equal subtrees have equal child ids.
+static unsigned node_hash(Parser *p, NodeId node)
+{
+    const AST *tree = p->tree;
+    int token = tree->tokens[node];
+    unsigned hash = tree->kinds[node];
+    switch (ast_kind(tree, node))
+    {
+    case AST_NUMBER:
+    {
+        const char *text = p->source + p->tokens->offsets[token];
+        for (int i = 0; i < p->tokens->lengths[token]; i++)
+            hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+        break;
+    }
+    case AST_IDENTIFIER:
+        hash = hash * 31 + (unsigned)p->tokens->ids[token];
+        break;
+    case AST_BINOP:
+        hash = hash * 31 + p->tokens->ops[token];
+        hash = hash * 31 + (unsigned)tree->left[node];
+        hash = hash * 31 + (unsigned)tree->right[node];
+        break;
+    default:
+        hash = hash * 31 + (unsigned)tree->left[node];
+        break;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3bu;
+    return hash ^ (hash >> 16);
+}
+
+static int same_node(Parser *p, NodeId a, NodeId b)
+{
+    const AST *tree = p->tree;
+    const TokenStream *tokens = p->tokens;
+    int ta = tree->tokens[a], tb = tree->tokens[b];
+    if (tree->kinds[a] != tree->kinds[b])
+        return 0;
+    switch (ast_kind(tree, a))
+    {
+    case AST_NUMBER:
+        return tokens->lengths[ta] == tokens->lengths[tb] &&
+               memcmp(p->source + tokens->offsets[ta], p->source + tokens->offsets[tb],
+                      tokens->lengths[ta]) == 0;
+    case AST_IDENTIFIER:
+        return tokens->ids[ta] == tokens->ids[tb];
+    case AST_BINOP:
+        return tokens->ops[ta] == tokens->ops[tb] && tree->left[a] == tree->left[b] &&
+               tree->right[a] == tree->right[b];
+    default:
+        return tree->left[a] == tree->left[b];
+    }
+}
+
+// Double the sharing table and reinsert its nodes. Returns 0 if memory
+// runs out.
+static int grow_shared(Parser *p)
+{
+    int capacity = p->shared_capacity ? p->shared_capacity * 2 : 256;
+    NodeId *table = calloc(capacity, sizeof(NodeId));
+    if (!table)
+    {
+        return 0;
+    }
+    for (int i = 0; i < p->shared_capacity; i++)
+    {
+        NodeId node = p->shared[i];
+        if (!node)
+            continue;
+        unsigned slot = node_hash(p, node) & (capacity - 1);
+        while (table[slot])
+            slot = (slot + 1) & (capacity - 1);
+        table[slot] = node;
+    }
+    free(p->shared);
+    p->shared = table;
+    p->shared_capacity = capacity;
+    return 1;
+}
+
+// Hash-consing of a finished number, identifier, factorial or binary
+// operator node: if the tree already has a node with the same structure,
+// return that one instead. A duplicate that was the last node created is
+// taken back. The shared node keeps the token and span of its first
+// occurrence.
+static NodeId share_node(Parser *p, NodeId node)
+{
+    if (!p->hash_consing || !node)
+    {
+        return node;
+    }
+    if (ast_kind(p->tree, node) == AST_IDENTIFIER && p->tokens->ids[p->tree->tokens[node]] < 0)
+    {
+        return node; // Name was not interned
+    }
+    if ((p->shared_count + 1) * 2 > p->shared_capacity && !grow_shared(p))
+    {
+        return node;
+    }
+
+    unsigned mask = p->shared_capacity - 1;
+    unsigned slot = node_hash(p, node) & mask;
+    for (; p->shared[slot]; slot = (slot + 1) & mask)
+    {
+        NodeId existing = p->shared[slot];
+        if (same_node(p, existing, node))
+        {
+            if (node == p->tree->count - 1)
+                p->tree->count--;
+            return existing;
+        }
+    }
+    p->shared[slot] = node;
+    p->shared_count++;
+    return node;
+}
+
+// Report a grammar event to a single-pass client, if there is one
+static inline void emit(Parser *p, ParseEvent event, Token token)
+{
+    if (p->on_event)
+        p->on_event(p->event_state, event, token);
+}
+
+// Match current token with expected type
+static int match(Parser *p, TokenType type)
+{
+    return p->tokens->types[slot(p, p->token_index)] == type;
+}
+
+// Expect a token type or error
+static void expect(Parser *p, TokenType type)
+{
+    if (match(p, type))
+    {
+        advance(p);
+    }
+    else
+    {
+        parse_error(p, PARSE_ERROR_UNEXPECTED_TOKEN);
+    }
+}
+
+// Forward declarations
+static NodeId parse_statement(Parser *p);
+
+// Skip the rest of a statement after an error: up to and including the
+// next ';', or up to a '}' or the end of the input. A statement that
+// already ended with ';' or '}' is left alone, and a statement that did
+// not consume anything loses at least its first token.
+static void synchronize(Parser *p, int start)
+{
+    if (p->token_index == start)
+    {
+        advance(p);
+    }
+    else
+    {
+        TokenType last = (TokenType)p->tokens->types[slot(p, p->token_index - 1)];
+        if (last == TOKEN_SEMICOLON || last == TOKEN_RBRACE)
+        {
+            p->panic = 0;
+            return;
+        }
+    }
+    while (!match(p, TOKEN_SEMICOLON) && !match(p, TOKEN_RBRACE) && !match(p, TOKEN_EOF))
+    {
+        advance(p);
+    }
+    if (match(p, TOKEN_SEMICOLON))
+    {
+        advance(p);
+    }
+    p->panic = 0;
+}
+
+// Parse one statement of a program or block and recover if it fails.
+// The statement's span covers the tokens skipped while recovering.
+static void parse_sequence_statement(Parser *p)
+{
+    int start = p->token_index;
+    int outer = p->unit;
+    p->unit = start;
+    emit(p, PARSE_EVENT_STATEMENT, p->current_token);
+    NodeId statement = parse_statement(p);
+    if (p->panic)
+    {
+        synchronize(p, start);
+    }
+    emit(p, PARSE_EVENT_STATEMENT_END, p->current_token);
+    end_span(p, statement);
+    push_statement(p, statement);
+    p->unit = outer;
+}
+
+// TODO 3: Add parsing functions for each new statement type
+static NodeId parse_if_statement(Parser *p);
+static NodeId parse_while_statement(Parser *p);
+static NodeId parse_repeat_statement(Parser *p);
+static NodeId parse_print_statement(Parser *p);
+static NodeId parse_block(Parser *p);// { ... }
+static NodeId parse_factorial(Parser *p);
+static NodeId parse_expression(Parser *p);
+static NodeId parse_expr_prec(Parser *p, int min_prec);
+
+
+// Parse if statement: if (x) {y}
+// UNTESTED
+static NodeId parse_if_statement(Parser *p)
+{
+
+    // the 'if' itself
+    NodeId node = create_node(p, AST_IF);
+    Token keyword = p->current_token;
+    advance(p);
+
+    // Parenthesis handling done within functions
+    
+    set_left(p, node, parse_expr_prec(p, 0));
+    emit(p, PARSE_EVENT_CONDITION, keyword);
+    
+    set_right(p, node, parse_block(p));
+    emit(p, PARSE_EVENT_IF_END, keyword);
+
+    return node;
+}
+
+// Parse while statement: while (x) {y}
+// UNTESTED
+static NodeId parse_while_statement(Parser *p)
+{
+
+    // the 'while' itself
+    NodeId node = create_node(p, AST_WHILE);
+    Token keyword = p->current_token;
+    emit(p, PARSE_EVENT_LOOP, keyword);
+    advance(p);
+
+    // Parenthesis handling done within functions
+    
+    set_left(p, node, parse_expr_prec(p, 0));
+    emit(p, PARSE_EVENT_CONDITION, keyword);
+    
+    set_right(p, node, parse_block(p));
+    emit(p, PARSE_EVENT_WHILE_END, keyword);
+
+    return node;
+}
+
+// Parse factorial function: factorial(x) 
+/*
+IMPORTANT: I asked Dr. Acharya in class whether the factorial function
+should recursively build out a parse tree like:
+
+           fac
+    /   /   |   \   \
+   (   id   *  fac   )
+        |   / / | \ \
+        x  ( id * fac )
+             |   //|\\
+            x-1
+
+... and so on until x == 1,
+or whether it could simply be 
+
+            fac
+          /  |  \
+          (  x  )
+
+... with the multiplication being implied as the function's process.
+Dr. Acharya said the latter is sufficient. This code reflects that.
+*/
+static NodeId parse_factorial(Parser *p)
+{
+    NodeId node = create_node(p, AST_FACTORIAL);
+    Token keyword = p->current_token;
+    advance(p); // consume factorial
+
+    // '('
+    if (!match(p, TOKEN_LPAREN))
+    {
+        parse_error(p, PARSE_ERROR_MISSING_PARENTHESIS);
+        return node;
+    }
+    advance(p);
+
+    // 'x'
+    set_left(p, node, parse_expr_prec(p, 0));
+
+    // ')'
+    if (!match(p, TOKEN_RPAREN))
+    {
+        parse_error(p, PARSE_ERROR_MISSING_PARENTHESIS);
+        return node;
+    }
+    
+    advance(p);
+    emit(p, PARSE_EVENT_FACTORIAL, keyword);
+    return node;
+
+}
+
+// parse 'repeat {x} until (y)'
+static NodeId parse_repeat_statement(Parser *p)
+{
+    // 'repeat'
+    NodeId node = create_node(p, AST_REPEAT);
+    emit(p, PARSE_EVENT_LOOP, p->current_token);
+    advance(p);
+
+    // '{statements}'
+    set_left(p, node, parse_block(p));
+    
+    // 'until'
+    if (!match(p, TOKEN_UNTIL)) 
+    {
+        parse_error(p, PARSE_ERROR_MISSING_UNTILS);
+        return node;
+    }
+    Token keyword = p->current_token;
+    advance(p); 
+
+    // condition
+    set_right(p, node, parse_expr_prec(p, 0));
+    emit(p, PARSE_EVENT_UNTIL, keyword);
+
+    return node;
+}
+
+// parse {code} blocks
+static NodeId parse_block(Parser *p) 
+{
+    
+    // `{`
+    if (!match(p, TOKEN_LBRACE)) 
+    {
+        parse_error(p, PARSE_ERROR_MISSING_BLOCK);
+        return 0;
+    }
+    int open = p->token_index;
+    int outer = p->unit;
+    p->unit = open;
+    emit(p, PARSE_EVENT_BLOCK, p->current_token);
+    advance(p); 
+
+    // one or more statements: following logic of parse_program()
+    NodeId block = create_node(p, AST_BLOCK);
+    set_start(p, block, open);
+    int base = p->pending_count;
+
+    while (!match(p, TOKEN_RBRACE) && !match(p, TOKEN_EOF)) 
+    {
+        parse_sequence_statement(p);
+    }
+    end_sequence(p, block, base);
+    emit(p, PARSE_EVENT_BLOCK_END, p->current_token);
+
+    // '}'
+    if (!match(p, TOKEN_RBRACE)) 
+    {
+        parse_error(p, PARSE_ERROR_MISSING_BLOCK);
+    }
+    else
+    {
+        advance(p);
+    }
+    end_span(p, block);
+    p->unit = outer;
+
+    return block;
+}
+
+// Parse variable declaration: int x;
+static NodeId parse_declaration(Parser *p)
+{
+    NodeId node = create_node(p, AST_VARDECL);
+    advance(p); // consume 'int'
+
+    if (!match(p, TOKEN_IDENTIFIER))
+    {
+        parse_error(p, PARSE_ERROR_MISSING_IDENTIFIER);
+        return 0;
+    }
+
+    set_token(p, node, p->token_index);
+    emit(p, PARSE_EVENT_DECLARATION, p->current_token);
+    advance(p);
+
+    if (!match(p, TOKEN_SEMICOLON))
+    {
+        parse_error(p, PARSE_ERROR_MISSING_SEMICOLON);
+        return node;
+    }
+    advance(p);
+    return node;
+}
+
+// Parse assignment: x = 5;
+static NodeId parse_assignment(Parser *p)
+{
+    NodeId node = create_node(p, AST_ASSIGN);
+    NodeId target = create_node(p, AST_IDENTIFIER);
+    Token name = p->current_token;
+    advance(p);
+    end_span(p, target);
+    set_left(p, node, target);
+
+    if (!match(p, TOKEN_EQUALS))
+    {
+        parse_error(p, PARSE_ERROR_MISSING_EQUALS);
+        return 0;
+    }
+    advance(p);
+    emit(p, PARSE_EVENT_ASSIGN_TARGET, name);
+
+    set_right(p, node, parse_expr_prec(p, 0));
+    emit(p, PARSE_EVENT_ASSIGN, name);
+
+    if (!match(p, TOKEN_SEMICOLON))
+    {
+        parse_error(p, PARSE_ERROR_MISSING_SEMICOLON);
+        return node;
+    }
+    advance(p);
+    return node;
+}
+
+// Parse print statements
+static NodeId parse_print_statement(Parser *p) {
+    NodeId node = create_node(p, AST_PRINT);
+    Token keyword = p->current_token;
+    advance(p); // consume the 'print' keyword
+    set_left(p, node, parse_expression(p));
+    emit(p, PARSE_EVENT_PRINT, keyword);
+    if (!match(p, TOKEN_SEMICOLON))
+    {
+        parse_error(p, PARSE_ERROR_MISSING_SEMICOLON);
+        return node;
+    }
+    advance(p);
+    return node;
+}
+
+
+// Parse statement
+static NodeId parse_statement(Parser *p)
+{
+    if (match(p, TOKEN_INT))
+    {
+        return parse_declaration(p);
+    }
+    else if (match(p, TOKEN_IDENTIFIER))
+    {
+        return parse_assignment(p);
+    }
+    else if (match(p, TOKEN_IF)) 
+    {
+        return parse_if_statement(p);
+    }
+    else if (match(p, TOKEN_WHILE)) 
+    {
+        return parse_while_statement(p);
+    }
+    else if (match(p, TOKEN_FACT))
+    {
+        return parse_factorial(p);
+    }
+    else if (match(p, TOKEN_REPEAT))
+    {
+        return parse_repeat_statement(p);
+    }
+    else if (match(p, TOKEN_PRINT))
+    {
+        return parse_print_statement(p);
+    }
+    // TODO 4: Add cases for new statement types
+    // else if (match(p, TOKEN_REPEAT)) return parse_repeat_statement(p);
+    // else if (match(p, TOKEN_PRINT)) return parse_print_statement(p);
+    // ...
+
+    parse_error(p, PARSE_ERROR_UNEXPECTED_TOKEN);
+    return 0;
+}
+
+// Parse expression (currently only handles numbers and identifiers)
+
+// TODO 5: Implement expression parsing
+// Current expression parsing is basic. Need to implement:
+// - Binary operations (+-*/)
+// - Comparison operators (<, >, ==, etc.)
+// - Operator precedence
+// - Parentheses grouping
+// - Function calls
+
+static NodeId parse_expression(Parser *p)
+{
+    NodeId node;
+
+    if (match(p, TOKEN_LPAREN)) {
+        advance(p);
+        node = parse_expr_prec(p, 0);
+        if (!match(p, TOKEN_RPAREN)) {
+            parse_error(p, PARSE_ERROR_MISSING_PARENTHESIS);
+            return node;
+        }
+        advance(p);
+    }
+    else if (match(p, TOKEN_NUMBER))
+    {
+        node = create_node(p, AST_NUMBER);
+        emit(p, PARSE_EVENT_NUMBER, p->current_token);
+        advance(p);
+        end_span(p, node);
+        node = share_node(p, node);
+    }
+    else if (match(p, TOKEN_IDENTIFIER))
+    {
+        node = create_node(p, AST_IDENTIFIER);
+        emit(p, PARSE_EVENT_IDENTIFIER, p->current_token);
+        advance(p);
+        end_span(p, node);
+        node = share_node(p, node);
+    }
+    else if (match(p, TOKEN_FACT))
+    {
+        node = parse_factorial(p);
+        end_span(p, node);
+        node = share_node(p, node);
+    }
+    else if (match(p, TOKEN_PRINT))
+    {
+        Token keyword = p->current_token;
+        emit(p, PARSE_EVENT_PRINT_OPERAND, keyword);
+        node = parse_print_statement(p);
+        emit(p, PARSE_EVENT_PRINT_OPERAND_END, keyword);
+        end_span(p, node);
+    }
+    else
+    {
+        parse_error(p, PARSE_ERROR_INVALID_EXPRESSION);
+        return 0;
+    }
+
+    return node;
+}
+
+// Binding power and associativity of each operator kind, indexed by
+// the kind the lexer put on the token. Higher binds tighter; -1 means
+// "not a binary operator".
+static const struct
+{
+    signed char precedence;
+    unsigned char right_assoc;
+} operator_table[OP_KIND_COUNT] = {
+    {-1, 0}, // OP_NONE
+    {2, 0},  // OP_ADD
+    {2, 0},  // OP_SUB
+    {3, 0},  // OP_MUL
+    {3, 0},  // OP_DIV
+    {1, 0},  // OP_EQ
+    {1, 0},  // OP_LT
+    {1, 0},  // OP_LE
+    {1, 0},  // OP_GT
+    {1, 0},  // OP_GE
+};
+
+// Precedence of the current token as a binary operator, -1 if it is not one
+static int current_precedence(Parser *p)
+{
+    int current = slot(p, p->token_index);
+    TokenType type = (TokenType)p->tokens->types[current];
+    if (type != TOKEN_OPERATOR && type != TOKEN_COMPARE)
+        return -1;
+    return operator_table[p->tokens->ops[current]].precedence;
+}
+
+// Precedence climbing: operators come from the table above, so no
+// operator text is compared while parsing
+static NodeId parse_expr_prec(Parser *p, int min_prec)
+{
+    int start = p->token_index;
+    NodeId left = parse_expression(p);
+
+    int prec;
+    while ((prec = current_precedence(p)) >= 0 && prec >= min_prec)
+    {
+        int op = p->token_index;
+        Token op_token = p->current_token;
+        int next_min = operator_table[p->tokens->ops[slot(p, op)]].right_assoc ? prec : prec + 1;
+        advance(p);
+
+        NodeId right = parse_expr_prec(p, next_min);
+        emit(p, PARSE_EVENT_BINARY, op_token);
+
+        NodeId binop_node = create_node(p, AST_BINOP);
+        set_token(p, binop_node, op);
+        set_start(p, binop_node, start);
+        end_span(p, binop_node);
+        set_left(p, binop_node, left);
+        set_right(p, binop_node, right);
+
+        left = share_node(p, binop_node);
+    }
+
+    return left;
+}
+
+// Parse program (multiple statements)
+static NodeId parse_program(Parser *p)
+{
+    NodeId program = create_node(p, AST_PROGRAM);
+    int base = p->pending_count;
+
+    while (!match(p, TOKEN_EOF))
+    {
+        parse_sequence_statement(p);
+    }
+    end_sequence(p, program, base);
+    end_span(p, program);
+
+    return program;
+}
+
+// Initialize parser with a token stream produced by tokenize_all().
+// The caller keeps ownership of the stream.
+void parser_init_tokens(Parser *p, const char *input, TokenStream *stream)
+{
+    memset(p, 0, sizeof(Parser));
+    p->source = input;
+    line_index_init(&p->lines, input);
+    p->tokens = stream;
+    p->token_index = 0;
+    p->current_token = token_at(p->tokens, 0); // Get first token
+    p->result.source = input;
+}
+
+// Allocate the trees of the following parses from an arena. free_ast()
+// then only drops the token stream; the nodes go with arena_reset() or
+// arena_free(). Pass NULL to go back to malloc'ed trees. Call it after
+// parser_init(), which resets the parser.
+void parser_set_arena(Parser *p, Arena *node_arena)
+{
+    p->arena = node_arena;
+}
+
+// Let the following parses share one node between identical number,
+// identifier, factorial and binary operator subtrees, so repeated
+// expressions are stored once and later passes can cache results per
+// node. The tree is then a DAG: print_ast still prints every
+// occurrence, but a shared node has the token and span of its first
+// occurrence only (analyze_semantics finds the token of each use in its
+// statement). Call it after parser_init().
+void parser_set_hash_consing(Parser *p, int enabled)
+{
+    p->hash_consing = enabled;
+}
+
+// Initialize parser: lex the whole input up front. Returns 0 if memory
+// runs out.
+int parser_init(Parser *p, const char *input)
+{
+    TokenStream *stream = tokenize_all(input);
+    if (!stream)
+    {
+        memset(p, 0, sizeof(Parser));
+        return 0;
+    }
+    parser_init_tokens(p, input, stream);
+    p->owns_tokens = 1;
+    return 1;
+}
+
+// Initialize parser and start lexing the input on a second thread. The
+// parser takes tokens from it as it goes, so lexing and parsing overlap
+// instead of lexing the whole input first. Returns 0 if memory or
+// threads run out.
+int parser_init_pipelined(Parser *p, const char *input)
+{
+    memset(p, 0, sizeof(Parser));
+    TokenStream *stream = token_stream_new((int)(strlen(input) / 4) + 16);
+    if (stream)
+    {
+        stream->strings = string_table_new();
+    }
+    if (!stream || !stream->strings)
+    {
+        free_token_stream(stream);
+        return 0;
+    }
+    LexerPipeline *pipeline = lexer_pipeline_start(input, (int)strlen(input), stream->strings);
+    if (!pipeline || !lexer_pipeline_read(pipeline, stream))
+    {
+        lexer_pipeline_stop(pipeline);
+        free_token_stream(stream);
+        return 0;
+    }
+    parser_init_tokens(p, input, stream);
+    p->owns_tokens = 1;
+    p->pipeline = pipeline;
+    return 1;
+}
+
+// Release what an initialized parser holds. Only needed when parse() is
+// not called, since parse() hands everything over to its result.
+void parser_free(Parser *p)
+{
+    lexer_pipeline_stop(p->pipeline);
+    p->pipeline = NULL;
+    if (p->owns_tokens)
+    {
+        free_token_stream(p->tokens);
+    }
+    p->tokens = NULL;
+    p->owns_tokens = 0;
+    line_index_free(&p->lines);
+    free(p->pending);
+    p->pending = NULL;
+    free(p->shared);
+    p->shared = NULL;
+    p->shared_count = 0;
+    p->shared_capacity = 0;
+    free_ast(p->tree);
+    p->tree = NULL;
+    free(p->result.diagnostics);
+    memset(&p->result, 0, sizeof(ParseResult));
+}
+
+// Allocate part of a finished tree
+static void *tree_alloc(Arena *arena, size_t size)
+{
+    return arena ? arena_alloc(arena, size) : malloc(size);
+}
+
+// Number the nodes reachable from root in preorder, starting at 1.
+// Fills new_id (old id -> new id) and order (new id -> old id), adds up
+// the statements of the reachable sequences in *list_total, and returns
+// the node count including the sentinel, or 0 if memory runs out.
+// A node shared by several parents is numbered once, when it is first
+// pushed, so the stack never holds more than one entry per node.
+static int number_preorder(const AST *built, NodeId root, NodeId *new_id, NodeId *order,
+                           int *list_total)
+{
+    NodeId *stack = malloc(built->count * sizeof(NodeId));
+    if (!stack)
+    {
+        return 0;
+    }
+
+    // Children are pushed last to first so the first comes out first.
+    // new_id is -1 while a node waits on the stack.
+    int count = 1;
+    int depth = 0;
+    *list_total = 0;
+    if (root)
+    {
+        new_id[root] = -1;
+        stack[depth++] = root;
+    }
+    while (depth > 0)
+    {
+        NodeId node = stack[--depth];
+        new_id[node] = count;
+        order[count++] = node;
+        if (ast_is_sequence(ast_kind(built, node)))
+        {
+            const NodeId *children = ast_children(built, node);
+            int n = ast_child_count(built, node);
+            for (int i = n - 1; i >= 0; i--)
+            {
+                new_id[children[i]] = -1;
+                stack[depth++] = children[i];
+            }
+            *list_total += n;
+            continue;
+        }
+        NodeId right = built->right[node];
+        NodeId left = built->left[node];
+        if (right && !new_id[right])
+        {
+            new_id[right] = -1;
+            stack[depth++] = right;
+        }
+        if (left && !new_id[left])
+        {
+            new_id[left] = -1;
+            stack[depth++] = left;
+        }
+    }
+    order[0] = 0;
+
+    free(stack);
+    return count;
+}
+
+// Copy the nodes reachable from root into a new tree laid out in
+// preorder. Nodes dropped by error recovery are left behind.
+static AST *layout_preorder(const AST *built, NodeId root, Arena *arena)
+{
+    NodeId *new_id = calloc(built->count, sizeof(NodeId));
+    NodeId *order = malloc(built->count * sizeof(NodeId));
+    int list_total = 0;
+    int count = new_id && order ? number_preorder(built, root, new_id, order, &list_total) : 0;
+
+    AST *ast = count ? tree_alloc(arena, sizeof(AST)) : NULL;
+    if (ast)
+    {
+        memset(ast, 0, sizeof(AST));
+        ast->arena = arena;
+        ast->kinds = tree_alloc(arena, count * sizeof(unsigned char));
+        ast->tokens = tree_alloc(arena, count * sizeof(int));
+        ast->starts = tree_alloc(arena, count * sizeof(int));
+        ast->ends = tree_alloc(arena, count * sizeof(int));
+        ast->left = tree_alloc(arena, count * sizeof(NodeId));
+        ast->right = tree_alloc(arena, count * sizeof(NodeId));
+        ast->lists = tree_alloc(arena, (list_total > 0 ? list_total : 1) * sizeof(NodeId));
+        if (!ast->kinds || !ast->tokens || !ast->starts || !ast->ends || !ast->left ||
+            !ast->right || !ast->lists)
+        {
+            free_ast(ast);
+            ast = NULL;
+        }
+    }
+
+    if (ast)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            NodeId old = order[i];
+            ast->kinds[i] = built->kinds[old];
+            ast->tokens[i] = built->tokens[old];
+            ast->starts[i] = built->starts[old];
+            ast->ends[i] = built->ends[old];
+            if (ast_is_sequence(ast_kind(built, old)))
+            {
+                // Statement lists end up in preorder of their sequences
+                const NodeId *children = ast_children(built, old);
+                int n = ast_child_count(built, old);
+                ast->left[i] = ast->list_count;
+                ast->right[i] = n;
+                for (int c = 0; c < n; c++)
+                    ast->lists[ast->list_count++] = new_id[children[c]];
+            }
+            else
+            {
+                ast->left[i] = new_id[built->left[old]];
+                ast->right[i] = new_id[built->right[old]];
+            }
+        }
+        ast->count = count;
+        ast->capacity = count;
+        ast->list_capacity = list_total;
+        ast->root = new_id[root];
+    }
+
+    free(new_id);
+    free(order);
+    return ast;
+}
+
+// Hand a finished tree over to a result together with the token stream
+// and diagnostics. Leaves the parser empty.
+static ParseResult hand_over(Parser *p, AST *ast)
+{
+    ParseResult result = p->result;
+    memset(&p->result, 0, sizeof(ParseResult));
+    if (ast)
+    {
+        // Nodes refer to their tokens by index, so the tree keeps the stream
+        ast->stream = p->tokens;
+        ast->shared = p->hash_consing;
+        ast->source = p->source;
+        ast->owns_stream = p->owns_tokens;
+        p->owns_tokens = 0;
+    }
+    else
+    {
+        result.out_of_memory = 1;
+    }
+    result.ast = ast;
+
+    parser_free(p);
+    return result;
+}
+
+// Lay the parsed program out in preorder and hand it over to a result
+static ParseResult take_result(Parser *p, NodeId program)
+{
+    return hand_over(p, p->tree ? layout_preorder(p->tree, program, p->arena) : NULL);
+}
+
+// Main parse function. Never exits: errors are collected in the result
+// together with the tree, and the parser is left empty.
+ParseResult parse(Parser *p)
+{
+    // A pipelined stream is still filling up; its capacity is an estimate
+    // of the final size
+    p->tree = ast_new((p->pipeline ? p->tokens->capacity : p->tokens->count) + 1);
+    NodeId program = p->tree ? parse_program(p) : 0;
+    return take_result(p, program);
+}
+
+// Inputs with fewer tokens than this per thread are parsed serially
+#define PARALLEL_PARSE_MIN_TOKENS (64 * 1024)
+
+// One run of top-level statements, parsed on its own thread
+typedef struct
+{
+    const char *source;
+    TokenStream *tokens;        // Shared by all runs, only read
+    int start;                  // Token the first statement starts at
+    int end;                    // Statements are parsed while they start before this
+    int stop;                   // Token after the last statement
+    AST *tree;                  // Preorder tree; node 1 holds the statements
+    ParseResult result;         // Diagnostics of the run
+} ParseChunk;
+
+static void *parse_chunk(void *arg)
+{
+    ParseChunk *chunk = arg;
+    Parser p;
+    parser_init_tokens(&p, chunk->source, chunk->tokens);
+    p.token_index = chunk->start;
+    p.current_token = token_at(p.tokens, p.token_index);
+    p.tree = ast_new(chunk->end > chunk->start ? chunk->end - chunk->start + 2 : 2);
+    NodeId program = p.tree ? create_node(&p, AST_PROGRAM) : 0;
+    int base = p.pending_count;
+
+    while (program && p.token_index < chunk->end && !match(&p, TOKEN_EOF))
+    {
+        parse_sequence_statement(&p);
+    }
+    end_sequence(&p, program, base);
+
+    chunk->stop = program ? p.token_index : chunk->end;
+    chunk->tree = program ? layout_preorder(p.tree, program, NULL) : NULL;
+    chunk->result = p.result;
+    memset(&p.result, 0, sizeof(ParseResult));
+    if (!chunk->tree)
+    {
+        chunk->result.out_of_memory = 1;
+    }
+    parser_free(&p);
+    return NULL;
+}
+
+// Cut the token stream into up to `parts` runs of whole top-level
+// statements of roughly equal length. A run may end after a ';' or '}'
+// at brace depth 0, unless 'until' follows (a repeat-until goes on).
+// Error recovery can still carry a statement across a cut, which
+// parse_parallel() checks for. Fills cuts[0..runs] and returns the
+// number of runs.
+static int split_top_level(const TokenStream *tokens, int parts, int *cuts)
+{
+    int eof = tokens->count - 1;
+    int runs = 0;
+    int depth = 0;
+    cuts[0] = 0;
+    for (int i = 0; i + 1 < eof && runs + 1 < parts; i++)
+    {
+        TokenType type = (TokenType)tokens->types[i];
+        int boundary = 0;
+        if (type == TOKEN_LBRACE)
+        {
+            depth++;
+        }
+        else if (type == TOKEN_RBRACE && depth > 0)
+        {
+            boundary = --depth == 0;
+        }
+        else if (type == TOKEN_SEMICOLON)
+        {
+            boundary = depth == 0;
+        }
+        if (boundary && tokens->types[i + 1] != TOKEN_UNTIL &&
+            i + 1 >= (long long)eof * (runs + 1) / parts)
+        {
+            cuts[++runs] = i + 1;
+        }
+    }
+    cuts[++runs] = eof;
+    return runs;
+}
+
+// Put the runs' trees together under one program node, in the layout
+// layout_preorder() gives the whole program: the program's statement
+// list first, then each run's nodes and nested lists in source order
+static AST *join_chunks(const ParseChunk *chunks, int count, int eof, Arena *arena)
+{
+    int nodes = 2;
+    int statements = 0;
+    int lists = 0;
+    for (int k = 0; k < count; k++)
+    {
+        nodes += chunks[k].tree->count - 2;
+        statements += ast_child_count(chunks[k].tree, 1);
+        lists += chunks[k].tree->list_count;
+    }
+
+    AST *ast = tree_alloc(arena, sizeof(AST));
+    if (!ast)
+    {
+        return NULL;
+    }
+    memset(ast, 0, sizeof(AST));
+    ast->arena = arena;
+    ast->kinds = tree_alloc(arena, nodes * sizeof(unsigned char));
+    ast->tokens = tree_alloc(arena, nodes * sizeof(int));
+    ast->starts = tree_alloc(arena, nodes * sizeof(int));
+    ast->ends = tree_alloc(arena, nodes * sizeof(int));
+    ast->left = tree_alloc(arena, nodes * sizeof(NodeId));
+    ast->right = tree_alloc(arena, nodes * sizeof(NodeId));
+    ast->lists = tree_alloc(arena, (lists > 0 ? lists : 1) * sizeof(NodeId));
+    if (!ast->kinds || !ast->tokens || !ast->starts || !ast->ends || !ast->left ||
+        !ast->right || !ast->lists)
+    {
+        free_ast(ast);
+        return NULL;
+    }
+
+    // Sentinel, then the program node spanning every token
+    for (NodeId i = 0; i < 2; i++)
+    {
+        ast->kinds[i] = chunks[0].tree->kinds[i];
+        ast->tokens[i] = 0;
+        ast->starts[i] = 0;
+        ast->ends[i] = i ? eof : 0;
+        ast->left[i] = 0;
+        ast->right[i] = i ? statements : 0;
+    }
+
+    int node_base = 2;
+    int list_base = statements;
+    for (int k = 0; k < count; k++)
+    {
+        const AST *part = chunks[k].tree;
+        int shift = node_base - 2;
+        int n = ast_child_count(part, 1);
+        int list_shift = list_base - n;
+
+        for (int c = 0; c < n; c++)
+        {
+            ast->lists[ast->list_count++] = part->lists[c] + shift;
+        }
+        for (int l = n; l < part->list_count; l++)
+        {
+            ast->lists[l + list_shift] = part->lists[l] + shift;
+        }
+        for (NodeId i = 2; i < part->count; i++)
+        {
+            NodeId to = i + shift;
+            ast->kinds[to] = part->kinds[i];
+            ast->tokens[to] = part->tokens[i];
+            ast->starts[to] = part->starts[i];
+            ast->ends[to] = part->ends[i];
+            if (ast_is_sequence(ast_kind(part, i)))
+            {
+                ast->left[to] = part->left[i] + list_shift;
+                ast->right[to] = part->right[i];
+            }
+            else
+            {
+                ast->left[to] = part->left[i] ? part->left[i] + shift : 0;
+                ast->right[to] = part->right[i] ? part->right[i] + shift : 0;
+            }
+        }
+        node_base += part->count - 2;
+        list_base += part->list_count - n;
+    }
+    ast->list_count = lists;
+    ast->list_capacity = lists;
+    ast->count = nodes;
+    ast->capacity = nodes;
+    ast->root = 1;
+    return ast;
+}
+
+// Parse on up to `threads` threads. The top-level statements are split
+// into runs at boundaries found by a brace and semicolon scan over the
+// tokens, each run is parsed on its own thread, and the subtrees are
+// joined under one program node in source order. A run whose first
+// statement turns out to have been swallowed by the run before it (error
+// recovery skipping past the cut) is parsed again from where that one
+// stopped, so the result is the same as parse(). Small inputs, hash-consed
+// and pipelined parses are parsed serially. The parser is left empty.
+ParseResult parse_parallel(Parser *p, int threads)
+{
+    int eof = p->tokens->count - 1;
+    if (threads > eof / PARALLEL_PARSE_MIN_TOKENS)
+    {
+        threads = eof / PARALLEL_PARSE_MIN_TOKENS;
+    }
+    if (threads <= 1 || p->hash_consing || p->pipeline)
+    {
+        return parse(p);
+    }
+
+    int *cuts = malloc((threads + 1) * sizeof(int));
+    ParseChunk *chunks = calloc(threads, sizeof(ParseChunk));
+    pthread_t *workers = calloc(threads, sizeof(pthread_t));
+    if (!cuts || !chunks || !workers)
+    {
+        free(cuts);
+        free(chunks);
+        free(workers);
+        return parse(p);
+    }
+
+    int count = split_top_level(p->tokens, threads, cuts);
+    for (int k = 0; k < count; k++)
+    {
+        chunks[k].source = p->source;
+        chunks[k].tokens = p->tokens;
+        chunks[k].start = cuts[k];
+        chunks[k].end = cuts[k + 1];
+    }
+
+    // The first run is parsed here, like any that cannot get a thread
+    int started = 1;
+    for (; started < count; started++)
+    {
+        if (pthread_create(&workers[started], NULL, parse_chunk, &chunks[started]) != 0)
+        {
+            break;
+        }
+    }
+    parse_chunk(&chunks[0]);
+    for (int k = started; k < count; k++)
+    {
+        parse_chunk(&chunks[k]);
+    }
+    for (int k = 1; k < started; k++)
+    {
+        pthread_join(workers[k], NULL);
+    }
+
+    for (int k = 1; k < count; k++)
+    {
+        if (chunks[k].start != chunks[k - 1].stop)
+        {
+            free_ast(chunks[k].tree);
+            free(chunks[k].result.diagnostics);
+            memset(&chunks[k].result, 0, sizeof(ParseResult));
+            chunks[k].start = chunks[k - 1].stop;
+            parse_chunk(&chunks[k]);
+        }
+    }
+
+    // Diagnostics in source order, then the tree
+    int total = 0;
+    int ok = 1;
+    for (int k = 0; k < count; k++)
+    {
+        total += chunks[k].result.diagnostic_count;
+        ok = ok && chunks[k].tree;
+        p->result.out_of_memory |= chunks[k].result.out_of_memory;
+    }
+    ParseResult *result = &p->result;
+    result->diagnostics = total > 0 ? malloc(total * sizeof(ParseDiagnostic)) : NULL;
+    if (total > 0 && !result->diagnostics)
+    {
+        result->out_of_memory = 1;
+    }
+    for (int k = 0; k < count; k++)
+    {
+        if (result->diagnostics && chunks[k].result.diagnostic_count > 0)
+        {
+            memcpy(result->diagnostics + result->diagnostic_count, chunks[k].result.diagnostics,
+                   chunks[k].result.diagnostic_count * sizeof(ParseDiagnostic));
+            result->diagnostic_count += chunks[k].result.diagnostic_count;
+        }
+    }
+    result->diagnostic_capacity = result->diagnostic_count;
+    AST *ast = ok ? join_chunks(chunks, count, eof, p->arena) : NULL;
+
+    for (int k = 0; k < count; k++)
+    {
+        free_ast(chunks[k].tree);
+        free(chunks[k].result.diagnostics);
+    }
+    free(cuts);
+    free(chunks);
+    free(workers);
+    return hand_over(p, ast);
+}
+
+// Tokens lexed at a time by check_syntax and parse_single_pass
+#define SYNTAX_WINDOW 4096
+
+// Recognize `length` bytes of source in one pass without building a tree,
+// reporting grammar events to `handler` (may be NULL) as constructs are
+// recognized. The diagnostics are the ones parse() would report; the
+// result's ast is NULL. Tokens are lexed into a fixed window as the parser
+// asks for them. Names are interned into `strings` if it is not NULL, so
+// the events carry name ids.
+ParseResult parse_single_pass(const char *data, int length, StringTable *strings,
+                              ParseEventHandler handler, void *state)
+{
+    Parser p;
+    memset(&p, 0, sizeof(Parser));
+    p.source = data;
+    line_index_init(&p.lines, data);
+    p.result.source = data;
+    p.syntax_only = 1;
+    p.on_event = handler;
+    p.event_state = state;
+    p.owns_tokens = 1;
+    p.tokens = token_stream_new(SYNTAX_WINDOW);
+    if (!p.tokens)
+    {
+        p.result.out_of_memory = 1;
+        return p.result;
+    }
+    lexer_init_buffer(&p.lexer, data, length);
+    p.lexer.strings = strings;
+    fill_window(&p);
+    p.current_token = token_at(p.tokens, 0);
+
+    parse_program(&p);
+
+    ParseResult result = p.result;
+    memset(&p.result, 0, sizeof(ParseResult));
+    parser_free(&p);
+    return result;
+}
+
+// Check `length` bytes of source for syntax errors without building a
+// tree. Names are not interned, so memory use does not grow with the
+// input.
+ParseResult check_syntax_buffer(const char *data, int length)
+{
+    return parse_single_pass(data, length, NULL, NULL, NULL);
+}
+
+// Check a whole NUL-terminated string
+ParseResult check_syntax(const char *input)
+{
+    return check_syntax_buffer(input, (int)strlen(input));
+}
+
+// Initialize a push parser. Statements are passed to `on_statement` (may
+// be NULL) as they complete; parser_finish() returns the whole tree.
+// Hash-consing is not available in push mode. Returns 0 if memory runs
+// out.
+int parser_init_push(PushParser *push, StatementCallback on_statement, void *user)
+{
+    memset(push, 0, sizeof(PushParser));
+    push->on_statement = on_statement;
+    push->user = user;
+
+    Parser *p = &push->parser;
+    memset(p, 0, sizeof(Parser));
+    line_index_init(&p->lines, NULL);
+    lexer_init_buffer(&p->lexer, NULL, 0);
+    p->tokens = token_stream_new(256);
+    p->owns_tokens = 1;
+    p->tree = ast_new(256);
+    if (p->tokens)
+    {
+        p->tokens->strings = string_table_new();
+    }
+    if (!p->tree || !p->tokens || !p->tokens->strings)
+    {
+        parser_free(p);
+        return 0;
+    }
+
+    // The stream always ends with an EOF token, after the tokens lexed so far
+    Token eof = {TOKEN_EOF, 0, 0, ERROR_NONE, -1, OP_NONE};
+    token_stream_push(p->tokens, eof);
+    p->current_token = eof;
+    push->program = create_node(p, AST_PROGRAM);
+    push->base = p->pending_count;
+    return 1;
+}
+
+// Lex the pushed bytes before `limit` in place of the EOF token that ends
+// the stream, then put an EOF token back after them. Also tracks where
+// top-level statements may end: after a ';' or a '}' at brace depth 0.
+static void lex_pushed(PushParser *push, int limit)
+{
+    Parser *p = &push->parser;
+    TokenStream *tokens = p->tokens;
+    TokenType last = p->lexer.last_token_type;
+    lexer_resume(&p->lexer, push->buffer, limit, p->lexer.position, last);
+    p->lexer.strings = tokens->strings;
+
+    tokens->count--;
+    Token token;
+    do
+    {
+        // Keep room for the EOF token whatever happens
+        if (tokens->count + 2 > tokens->capacity && !token_stream_reserve(tokens, tokens->count + 2))
+        {
+            p->result.out_of_memory = 1;
+            token = (Token){TOKEN_EOF, p->lexer.position, 0, ERROR_NONE, -1, OP_NONE};
+        }
+        else
+        {
+            token = get_next_token(&p->lexer);
+            if (p->lexer.out_of_memory)
+                p->result.out_of_memory = 1;
+        }
+        token_stream_push(tokens, token);
+
+        if (token.type == TOKEN_LBRACE)
+        {
+            push->depth++;
+        }
+        else if (token.type == TOKEN_RBRACE && push->depth > 0)
+        {
+            push->depth--;
+        }
+        if ((token.type == TOKEN_SEMICOLON || token.type == TOKEN_RBRACE) && push->depth == 0)
+        {
+            push->ready = tokens->count;
+        }
+        if (token.type != TOKEN_EOF)
+        {
+            last = token.type;
+        }
+    } while (token.type != TOKEN_EOF);
+
+    // The EOF token only marks how far the input was lexed, so the next
+    // chunk still sees the operator before it
+    p->lexer.last_token_type = last;
+    p->current_token = token_at(tokens, p->token_index);
+}
+
+// Report a top-level statement parsed from tokens [start, token_index).
+// `pending` and `diagnostics` are the counts from before it was parsed.
+static void emit_statement(PushParser *push, int start, int pending, int diagnostics)
+{
+    Parser *p = &push->parser;
+    if (!push->on_statement)
+    {
+        return;
+    }
+    p->tree->stream = p->tokens;
+    p->tree->source = push->buffer;
+
+    PushedStatement statement;
+    statement.tree = p->tree;
+    statement.node = p->pending_count > pending ? p->pending[p->pending_count - 1] : 0;
+    statement.start = start;
+    statement.end = p->token_index;
+    statement.diagnostics = p->result.diagnostics + diagnostics;
+    statement.diagnostic_count = p->result.diagnostic_count - diagnostics;
+    push->on_statement(push->user, &statement);
+}
+
+// Parse the top-level statements that are complete. A statement is only
+// kept if the parser stopped before the EOF token: if it reached it, more
+// input could still change the statement (an operator continuing the
+// condition of a repeat-until, say), so it is taken back and parsed again
+// once more input has arrived.
+static void parse_ready(PushParser *push)
+{
+    Parser *p = &push->parser;
+    int eof = p->tokens->count - 1;
+    while (p->token_index < push->ready && push->ready < eof)
+    {
+        int start = p->token_index;
+        int nodes = p->tree->count;
+        int lists = p->tree->list_count;
+        int pending = p->pending_count;
+        int diagnostics = p->result.diagnostic_count;
+
+        parse_sequence_statement(p);
+        if (p->token_index >= eof)
+        {
+            p->token_index = start;
+            p->current_token = token_at(p->tokens, start);
+            p->tree->count = nodes;
+            p->tree->list_count = lists;
+            p->pending_count = pending;
+            p->result.diagnostic_count = diagnostics;
+            p->panic = 0;
+            return;
+        }
+        emit_statement(push, start, pending, diagnostics);
+    }
+}
+
+// Add `length` bytes of input and parse the statements they complete.
+// Returns 0 if memory runs out.
+int parser_feed(PushParser *push, const char *data, int length)
+{
+    Parser *p = &push->parser;
+    if (push->length + length + 1 > push->capacity)
+    {
+        int capacity = push->capacity ? push->capacity : 4096;
+        while (capacity < push->length + length + 1)
+        {
+            capacity *= 2;
+        }
+        char *buffer = realloc(push->buffer, capacity);
+        if (!buffer)
+        {
+            p->result.out_of_memory = 1;
+            return 0;
+        }
+        push->buffer = buffer;
+        push->capacity = capacity;
+        p->source = buffer;
+        p->lines.source = buffer;
+        p->result.source = buffer;
+    }
+    memcpy(push->buffer + push->length, data, length);
+    push->length += length;
+    push->buffer[push->length] = '\0';
+
+    // No token contains whitespace, so everything before the last
+    // whitespace byte can be lexed now
+    int limit = push->length;
+    while (limit > p->lexer.position && !char_is(push->buffer[limit - 1], CC_SPACE))
+    {
+        limit--;
+    }
+    if (limit > p->lexer.position)
+    {
+        lex_pushed(push, limit);
+        parse_ready(push);
+    }
+    return !p->result.out_of_memory;
+}
+
+// End of input: parse what is left and return the result, as parse()
+// does. The tree owns the pushed source. The push parser is left empty.
+ParseResult parser_finish(PushParser *push)
+{
+    Parser *p = &push->parser;
+    if (p->lexer.position < push->length)
+    {
+        lex_pushed(push, push->length);
+    }
+    while (!match(p, TOKEN_EOF))
+    {
+        int start = p->token_index;
+        int pending = p->pending_count;
+        int diagnostics = p->result.diagnostic_count;
+        parse_sequence_statement(p);
+        emit_statement(push, start, pending, diagnostics);
+    }
+    end_sequence(p, push->program, push->base);
+    end_span(p, push->program);
+
+    ParseResult result = take_result(p, push->program);
+    if (result.ast)
+    {
+        result.ast->owns_source = 1;
+    }
+    else
+    {
+        free(push->buffer);
+        result.source = NULL;
+    }
+    memset(push, 0, sizeof(PushParser));
+    return result;
+}
+
+// Release a push parser without finishing it
+void parser_free_push(PushParser *push)
+{
+    parser_free(&push->parser);
+    free(push->buffer);
+    memset(push, 0, sizeof(PushParser));
+}
+
+// Statements of one sequence that are parsed again after an edit:
+// children [first, last) of `sequence`, parsed from old tokens
+// [start, end). The range may also cover statements that were dropped
+// by error recovery, which have no node.
+typedef struct
+{
+    NodeId sequence;
+    int first;
+    int last;
+    int start;
+    int end;
+} ReparseRange;
+
+// Tokens the statements of a sequence are parsed from: all of a
+// program's, and everything between the braces of a block
+static int sequence_start(const AST *ast, NodeId sequence)
+{
+    return ast_kind(ast, sequence) == AST_BLOCK ? ast->starts[sequence] + 1 : ast->starts[sequence];
+}
+
+static int sequence_end(const AST *ast, NodeId sequence)
+{
+    return ast_kind(ast, sequence) == AST_BLOCK ? ast->ends[sequence] - 1 : ast->ends[sequence];
+}
+
+// One past the last node of a subtree. Nodes are in preorder and spans
+// are never empty, so only the node's descendants start inside its span.
+static NodeId subtree_end(const AST *ast, NodeId node)
+{
+    NodeId next = node + 1;
+    while (next < ast->count && ast->starts[next] < ast->ends[node])
+    {
+        next++;
+    }
+    return next;
+}
+
+// Whether the statement or block starting at token `unit` reported an
+// error itself. Such a unit may have left the parser in panic mode for
+// what follows inside it, so nothing within it is reparsed on its own.
+static int unit_has_errors(const ParseResult *result, int unit)
+{
+    for (int i = 0; i < result->diagnostic_count; i++)
+    {
+        if (result->diagnostics[i].unit == unit)
+            return 1;
+    }
+    return 0;
+}
+
+// Shortest run of statements of `sequence` that covers the changed old
+// tokens [a, b). The run starts and ends on statement boundaries, and
+// its first token is not changed: the parser already looked at it to
+// decide that the sequence goes on.
+static ReparseRange covering_statements(const AST *ast, NodeId sequence, int a, int b)
+{
+    const NodeId *children = ast_children(ast, sequence);
+    int n = ast_child_count(ast, sequence);
+    ReparseRange range = {sequence, 0, n, sequence_start(ast, sequence), sequence_end(ast, sequence)};
+
+    // Statements starting before the change
+    int low = 0, high = n;
+    while (low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if (ast->starts[children[mid]] < a)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low > 0)
+    {
+        NodeId before = children[low - 1];
+        range.first = ast->ends[before] < a ? low : low - 1;
+        range.start = ast->ends[before] < a ? ast->ends[before] : ast->starts[before];
+    }
+
+    // First statement ending at or after the change
+    low = range.first;
+    high = n;
+    while (low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if (ast->ends[children[mid]] < b)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low < n)
+    {
+        NodeId after = children[low];
+        range.last = ast->starts[after] >= b ? low : low + 1;
+        range.end = ast->starts[after] >= b ? ast->starts[after] : ast->ends[after];
+    }
+    return range;
+}
+
+// Ranges worth reparsing for a change to old tokens [a, b), innermost
+// first, starting from the statements that cover it in the deepest block
+// and widening to the enclosing statement at each level. Returns the
+// number of ranges, or -1 if memory runs out.
+static int collect_ranges(const ParseResult *result, int a, int b, ReparseRange **ranges)
+{
+    const AST *ast = result->ast;
+    int count = 0, capacity = 0;
+    NodeId sequence = ast->root;
+    *ranges = NULL;
+
+    for (;;)
+    {
+        ReparseRange range = covering_statements(ast, sequence, a, b);
+        if (range.end < b)
+            break;
+        if (count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 8;
+            ReparseRange *grown = realloc(*ranges, capacity * sizeof(ReparseRange));
+            if (!grown)
+                return -1;
+            *ranges = grown;
+        }
+        (*ranges)[count++] = range;
+
+        // Go down into a block of the one statement covering the change
+        if (range.last != range.first + 1)
+            break;
+        NodeId statement = ast_children(ast, sequence)[range.first];
+        if (range.start != ast->starts[statement] || unit_has_errors(result, range.start))
+            break;
+        NodeId inner = 0;
+        NodeId sides[2] = {ast->left[statement], ast->right[statement]};
+        for (int i = 0; i < 2; i++)
+        {
+            NodeId block = sides[i];
+            if (block && ast_kind(ast, block) == AST_BLOCK && sequence_start(ast, block) < a &&
+                b <= sequence_end(ast, block) && !unit_has_errors(result, ast->starts[block]))
+                inner = block;
+        }
+        if (!inner)
+            break;
+        sequence = inner;
+    }
+
+    // Inner ranges were found last
+    for (int i = 0; i < count / 2; i++)
+    {
+        ReparseRange swap = (*ranges)[i];
+        (*ranges)[i] = (*ranges)[count - 1 - i];
+        (*ranges)[count - 1 - i] = swap;
+    }
+    return count;
+}
+
+// Parse the statements of a range again from the edited stream, into a
+// new sequence node of the parser's tree. Returns 0 if they no longer
+// end where the old ones did, since then the rest of the old tree may
+// not follow from them.
+static NodeId reparse_range(Parser *p, ASTNodeType kind, const ReparseRange *range, int shift)
+{
+    int end = range->end + shift;
+    p->token_index = range->start;
+    p->current_token = token_at(p->tokens, p->token_index);
+
+    NodeId sequence = create_node(p, kind);
+    int base = p->pending_count;
+    while (p->token_index < end && !match(p, TOKEN_EOF) &&
+           !(kind == AST_BLOCK && match(p, TOKEN_RBRACE)))
+    {
+        parse_sequence_statement(p);
+    }
+    end_sequence(p, sequence, base);
+
+    return p->token_index == end ? sequence : 0;
+}
+
+// Replace the statements of `range` by those of `piece`, a tree whose
+// root is a sequence of the reparsed statements, and renumber the nodes,
+// lists and token indices after them. Returns 0 if memory runs out.
+static int splice_statements(AST *ast, const ReparseRange *range, const AST *piece, int shift)
+{
+    NodeId sequence = range->sequence;
+    const NodeId *children = ast_children(ast, sequence);
+    int n = ast_child_count(ast, sequence);
+
+    // Old nodes [n0, n1) go; new ones take their place
+    NodeId n0, n1;
+    if (range->first < range->last)
+    {
+        n0 = children[range->first];
+        n1 = subtree_end(ast, children[range->last - 1]);
+    }
+    else
+    {
+        n0 = range->first < n ? children[range->first]
+             : n > 0         ? subtree_end(ast, children[n - 1])
+                             : sequence + 1;
+        n1 = n0;
+    }
+
+    // Lists of the sequences among the old nodes, [l0, l1). Lists are in
+    // preorder of their sequences, so with no sequences among the old
+    // nodes the new lists start after those of the last sequence before.
+    int l0 = -1, nested = 0;
+    for (NodeId m = n0; m < n1; m++)
+    {
+        if (ast_is_sequence(ast_kind(ast, m)))
+        {
+            if (l0 < 0)
+                l0 = ast->left[m];
+            nested += ast->right[m];
+        }
+    }
+    if (l0 < 0)
+    {
+        NodeId m = n0 - 1;
+        while (!ast_is_sequence(ast_kind(ast, m)))
+            m--;
+        l0 = ast->left[m] + ast->right[m];
+    }
+    int l1 = l0 + nested;
+
+    int added = piece->count - 2;           // Piece nodes past its sentinel and root
+    int statements = ast_child_count(piece, piece->root);
+    int dn = added - (n1 - n0);
+    int dx = statements - (range->last - range->first);
+    int nested_added = piece->list_count - statements;
+    int dl = nested_added - nested;
+
+    if (!ast_reserve(ast, ast->count + dn) ||
+        !ast_reserve_lists(ast, ast->list_count + (dl > 0 ? dl : 0) + (dx > 0 ? dx : 0)))
+    {
+        return 0;
+    }
+
+    // Make room for the new nodes
+    int tail = ast->count - n1;
+    memmove(ast->kinds + n1 + dn, ast->kinds + n1, tail * sizeof(unsigned char));
+    memmove(ast->tokens + n1 + dn, ast->tokens + n1, tail * sizeof(int));
+    memmove(ast->starts + n1 + dn, ast->starts + n1, tail * sizeof(int));
+    memmove(ast->ends + n1 + dn, ast->ends + n1, tail * sizeof(int));
+    memmove(ast->left + n1 + dn, ast->left + n1, tail * sizeof(NodeId));
+    memmove(ast->right + n1 + dn, ast->right + n1, tail * sizeof(NodeId));
+    ast->count += dn;
+
+    // Make room for the new lists: the nested ones first, since they come
+    // after the sequence's own
+    int xi = ast->left[sequence] + range->first;
+    int xj = ast->left[sequence] + range->last;
+    memmove(ast->lists + l1 + dl, ast->lists + l1, (ast->list_count - l1) * sizeof(NodeId));
+    ast->list_count += dl;
+    memmove(ast->lists + xj + dx, ast->lists + xj, (ast->list_count - xj) * sizeof(NodeId));
+    ast->list_count += dx;
+    ast->right[sequence] += dx;
+
+    // Renumber the old nodes. Before the sequence, only its ancestors end
+    // or have children past the range.
+    for (NodeId m = 1; m <= sequence; m++)
+    {
+        if (ast->ends[m] >= range->end)
+            ast->ends[m] += shift;
+        if (!ast_is_sequence(ast_kind(ast, m)))
+        {
+            if (ast->left[m] >= n1)
+                ast->left[m] += dn;
+            if (ast->right[m] >= n1)
+                ast->right[m] += dn;
+        }
+    }
+    // Statements before the range keep their tokens and children, but the
+    // lists of their sequences move with the sequence's own list
+    for (NodeId m = sequence + 1; m < n0 && dx; m++)
+    {
+        if (ast_is_sequence(ast_kind(ast, m)))
+            ast->left[m] += dx;
+    }
+    // Everything after the range moves
+    NodeId after = n0 + added;
+    if (shift)
+    {
+        for (NodeId m = after; m < ast->count; m++)
+            ast->tokens[m] += shift;
+        for (NodeId m = after; m < ast->count; m++)
+            ast->starts[m] += shift;
+        for (NodeId m = after; m < ast->count; m++)
+            ast->ends[m] += shift;
+    }
+    if (dn || dx || dl)
+    {
+        for (NodeId m = after; m < ast->count; m++)
+        {
+            if (ast_is_sequence(ast_kind(ast, m)))
+            {
+                ast->left[m] += dx + dl;
+                continue;
+            }
+            if (ast->left[m])
+                ast->left[m] += dn;
+            if (ast->right[m])
+                ast->right[m] += dn;
+        }
+    }
+    if (dn)
+    {
+        for (int i = 0; i < ast->list_count; i++)
+        {
+            if ((i >= xi && i < xi + statements) || (i >= l0 + dx && i < l0 + dx + nested_added))
+                continue;
+            if (ast->lists[i] >= n1)
+                ast->lists[i] += dn;
+        }
+    }
+
+    // Copy in the new nodes and lists. Piece node q becomes n0 + q - 2,
+    // and its nested lists move from after its own statements to l0.
+    for (NodeId q = 2; q < piece->count; q++)
+    {
+        NodeId m = n0 + q - 2;
+        ast->kinds[m] = piece->kinds[q];
+        ast->tokens[m] = piece->tokens[q];
+        ast->starts[m] = piece->starts[q];
+        ast->ends[m] = piece->ends[q];
+        if (ast_is_sequence(ast_kind(piece, q)))
+        {
+            ast->left[m] = piece->left[q] - statements + l0 + dx;
+            ast->right[m] = piece->right[q];
+        }
+        else
+        {
+            ast->left[m] = piece->left[q] ? piece->left[q] - 2 + n0 : 0;
+            ast->right[m] = piece->right[q] ? piece->right[q] - 2 + n0 : 0;
+        }
+    }
+    for (int i = 0; i < statements; i++)
+        ast->lists[xi + i] = piece->lists[i] - 2 + n0;
+    for (int i = 0; i < nested_added; i++)
+        ast->lists[l0 + dx + i] = piece->lists[statements + i] - 2 + n0;
+    return 1;
+}
+
+// Replace the diagnostics of the reparsed statements by the new ones and
+// move the later ones along. Returns 0 if memory runs out.
+static int splice_diagnostics(ParseResult *result, const ReparseRange *range,
+                              const ParseResult *fresh, int shift)
+{
+    ParseDiagnostic *d = result->diagnostics;
+    int count = result->diagnostic_count;
+
+    // Diagnostics are in the order they were found. The ones reported
+    // before the range came last belong to an earlier statement; the ones
+    // reported inside belong to a statement or block starting in it.
+    int at = 0;
+    while (at < count && d[at].unit < range->start && d[at].token_index <= range->start)
+        at++;
+    int removed = 0;
+    while (at + removed < count && d[at + removed].unit >= range->start &&
+           d[at + removed].unit < range->end)
+        removed++;
+
+    int needed = count - removed + fresh->diagnostic_count;
+    if (needed > result->diagnostic_capacity)
+    {
+        ParseDiagnostic *grown = realloc(d, needed * sizeof(ParseDiagnostic));
+        if (!grown)
+        {
+            return 0;
+        }
+        result->diagnostics = d = grown;
+        result->diagnostic_capacity = needed;
+    }
+    if (needed == 0)
+    {
+        result->diagnostic_count = 0;
+        return 1;
+    }
+    int later = at + fresh->diagnostic_count;
+    memmove(d + later, d + at + removed, (count - at - removed) * sizeof(ParseDiagnostic));
+    if (fresh->diagnostic_count > 0)
+    {
+        memcpy(d + at, fresh->diagnostics, fresh->diagnostic_count * sizeof(ParseDiagnostic));
+    }
+    result->diagnostic_count = needed;
+
+    for (int i = later; i < needed; i++)
+    {
+        d[i].token_index += shift;
+        if (d[i].unit >= range->end)
+            d[i].unit += shift;
+    }
+    return 1;
+}
+
+// Tokens from `first` on may have new text or offsets: refresh the copies
+// the diagnostics keep, and their positions
+static void refresh_diagnostics(ParseResult *result, int first, const TokenStream *stream,
+                                LineIndex *lines)
+{
+    for (int i = 0; i < result->diagnostic_count; i++)
+    {
+        ParseDiagnostic *diagnostic = &result->diagnostics[i];
+        if (diagnostic->token_index >= first)
+        {
+            diagnostic->token = token_at(stream, diagnostic->token_index);
+            line_index_position(lines, diagnostic->token.offset, &diagnostic->line, &diagnostic->column);
+        }
+    }
+}
+
+// Reparse one range and splice it into the tree. Returns 1 on success,
+// 0 if the range does not reparse to the same extent, -1 if memory runs out.
+static int reparse_into(ParseResult *result, const ReparseRange *range, int shift)
+{
+    AST *ast = result->ast;
+    Parser p;
+    parser_init_tokens(&p, ast->source, ast->stream);
+    p.tree = ast_new(range->end + shift - range->start + 2);
+    NodeId sequence = p.tree ? reparse_range(&p, ast_kind(ast, range->sequence), range, shift) : 0;
+    int status = sequence ? 1 : 0;
+    if (!p.tree || p.result.out_of_memory)
+    {
+        status = -1;
+    }
+
+    AST *piece = status == 1 ? layout_preorder(p.tree, sequence, NULL) : NULL;
+    if (status == 1 && (!piece || !splice_statements(ast, range, piece, shift) ||
+                        !splice_diagnostics(result, range, &p.result, shift)))
+    {
+        status = -1;
+    }
+
+    free_ast(piece);
+    parser_free(&p);
+    return status;
+}
+
+// Parse the edited stream again as a whole, with the settings the tree
+// was built with. Needed for trees with shared nodes, which are not in
+// preorder and so cannot be spliced. Returns 1, or -1 if memory runs out.
+static int parse_again(ParseResult *result)
+{
+    AST *old = result->ast;
+    Parser p;
+    parser_init_tokens(&p, old->source, old->stream);
+    parser_set_arena(&p, old->arena);
+    parser_set_hash_consing(&p, old->shared);
+    ParseResult fresh = parse(&p);
+    if (!fresh.ast)
+    {
+        free_parse_result(&fresh);
+        return -1;
+    }
+
+    fresh.ast->owns_stream = old->owns_stream;
+    old->owns_stream = 0;
+    free_parse_result(result);
+    *result = fresh;
+    return 1;
+}
+
+// Bring a parse result up to date after an edit of its source. The tokens
+// are relexed around the edit, then only the smallest run of statements
+// around the changed tokens is parsed again; if it no longer ends where
+// it did, the enclosing statement is tried, and so on out to the whole
+// program. All other nodes are kept and renumbered in place; trees built
+// with hash-consing are parsed again as a whole instead. `new_source`
+// replaces the tree's source buffer and must stay alive with the tree.
+//
+// Returns the root of the updated tree, or 0 if memory runs out, after
+// which the result no longer matches its tokens and should be freed.
+NodeId reparse(ParseResult *result, const char *new_source, int new_length, TextEdit edit)
+{
+    AST *ast = result->ast;
+    if (!ast)
+    {
+        return 0;
+    }
+
+    TokenDelta delta;
+    if (!relex_edit(ast->stream, new_source, new_length, edit, &delta))
+    {
+        return 0;
+    }
+
+    // The parser only looks at token types and operator kinds, so tokens
+    // that keep both do not change the tree: trim them off the delta.
+    // The tree then needs reparsing around old tokens [a, b).
+    const TokenStream *old = ast->stream;
+    const TokenStream *inserted = delta.inserted;
+    int removed = delta.removed, added = inserted->count;
+    int same_front = 0, same_back = 0;
+    while (same_front < removed && same_front < added &&
+           old->types[delta.first + same_front] == inserted->types[same_front] &&
+           old->ops[delta.first + same_front] == inserted->ops[same_front])
+        same_front++;
+    while (same_back < removed - same_front && same_back < added - same_front &&
+           old->types[delta.first + removed - 1 - same_back] == inserted->types[added - 1 - same_back] &&
+           old->ops[delta.first + removed - 1 - same_back] == inserted->ops[added - 1 - same_back])
+        same_back++;
+    int a = delta.first + same_front;
+    int b = delta.first + removed - same_back;
+    int changed = b > a || added - same_front - same_back > 0;
+    if (ast->shared)
+    {
+        // Which nodes are shared also depends on names and numbers
+        changed = removed > 0 || added > 0;
+    }
+    int first = delta.first;
+    int shift = added - removed;
+
+    int applied = token_stream_apply(ast->stream, &delta);
+    free_token_delta(&delta);
+    if (!applied)
+    {
+        return 0;
+    }
+    if (ast->owns_source)
+    {
+        free((char *)ast->source);
+        ast->owns_source = 0;
+    }
+    ast->source = new_source;
+    result->source = new_source;
+
+    int status = 1;
+    if (changed && ast->shared)
+    {
+        status = parse_again(result);
+        ast = result->ast;
+    }
+    else if (changed)
+    {
+        // A result that lost diagnostics cannot tell which statements had
+        // errors, so it is always parsed again as a whole
+        ReparseRange *ranges = NULL;
+        int count = result->out_of_memory ? 0 : collect_ranges(result, a, b, &ranges);
+        status = 0;
+        for (int i = 0; i < count && status == 0; i++)
+        {
+            status = reparse_into(result, &ranges[i], shift);
+        }
+        free(ranges);
+        if (status == 0)
+        {
+            NodeId root = ast->root;
+            ReparseRange whole = {root, 0, ast_child_count(ast, root), sequence_start(ast, root),
+                                  sequence_end(ast, root)};
+            status = reparse_into(result, &whole, shift);
+            if (status == 1)
+                result->out_of_memory = 0;
+        }
+    }
+    if (status != 1)
+    {
+        result->out_of_memory = 1;
+        return 0;
+    }
+
+    LineIndex lines;
+    line_index_init(&lines, new_source);
+    refresh_diagnostics(result, first, ast->stream, &lines);
+    line_index_free(&lines);
+    return ast->root;
+}
+
+// Print the collected errors, one per line
+void print_parse_diagnostics(const ParseResult *result)
+{
+    for (int i = 0; i < result->diagnostic_count; i++)
+    {
+        const ParseDiagnostic *diagnostic = &result->diagnostics[i];
+        printf("Parse Error at line %d, column %d: ", diagnostic->line, diagnostic->column);
+        print_parse_error(result->source, diagnostic->error, diagnostic->token);
+    }
+    if (result->out_of_memory)
+    {
+        printf("Parse Error: out of memory, the result is incomplete\n");
+    }
+}
+
+// Free a parse result and its tree
+void free_parse_result(ParseResult *result)
+{
+    free_ast(result->ast);
+    free(result->diagnostics);
+    memset(result, 0, sizeof(ParseResult));
+}
+
+// Print AST (for debugging)
+void print_ast(const AST *ast, NodeId node, int level)
+{
+    if (!node)
+        return;
+
+    // Indent based on level
+    for (int i = 0; i < level; i++)
+        printf("  ");
+
+    // Print node info
+    Token token = ast_token(ast, node);
+    switch (ast_kind(ast, node))
+    {
+    case AST_PROGRAM:
+        printf("Program\n");
+        break;
+    case AST_VARDECL:
+        printf("VarDecl: %.*s\n", token.length, token_lexeme(ast->source, token));
+        break;
+    case AST_ASSIGN:
+        printf("Assign\n");
+        break;
+    case AST_NUMBER:
+        printf("Number: %.*s\n", token.length, token_lexeme(ast->source, token));
+        break;
+    case AST_IDENTIFIER:
+        printf("Identifier: %.*s\n", token.length, token_lexeme(ast->source, token));
+        break;
+
+    // TODO 6: Add cases for new node types
+    case AST_IF: printf("If\n"); break;
+    case AST_WHILE: printf("While\n"); break;
+    case AST_REPEAT: printf("Repeat-Until\n"); break;
+    case AST_BLOCK: printf("Block\n"); break;
+    case AST_PRINT: printf("Print\n"); break;
+    case AST_FACTORIAL:
+        printf("Factorial of:\n");
+        break;
+    case AST_BINOP:
+        printf("BinaryOp: %.*s\n", token.length, token_lexeme(ast->source, token));
+        break;
+    default:
+        printf("Unknown node type\n");
+    }
+
+    // Print children. Statements of a sequence are printed in a loop, so
+    // the recursion only goes as deep as the nesting.
+    if (ast_is_sequence(ast_kind(ast, node)))
+    {
+        const NodeId *children = ast_children(ast, node);
+        for (int i = 0; i < ast_child_count(ast, node); i++)
+            print_ast(ast, children[i], level + 1);
+        return;
+    }
+    print_ast(ast, ast->left[node], level + 1);
+    print_ast(ast, ast->right[node], level + 1);
+}
+
+// Free AST memory. Trees built in an arena only release their token
+// stream here; the nodes are released with the arena.
+void free_ast(AST *ast)
+{
+    if (!ast)
+        return;
+    if (ast->owns_stream)
+    {
+        free_token_stream(ast->stream);
+    }
+    if (ast->owns_source)
+    {
+        free((char *)ast->source);
+    }
+    if (!ast->arena)
+    {
+        free(ast->kinds);
+        free(ast->tokens);
+        free(ast->starts);
+        free(ast->ends);
+        free(ast->left);
+        free(ast->right);
+        free(ast->lists);
+        free(ast);
+    }
+}
+
+void test_case_1(void);
+void test_case_2(void);
+
+// Main function for testing
+// int main()
+// {
+//     // Test with both valid and invalid inputs
+//     const char *input = "int x;\n"   // Valid declaration
+//                         "x = 42;\n" // Valid assignment;
+//
+//                         // comment and uncomment out these lines at will
+//                         // to see how valid and invalid output proceed
+//                         "if (x <= 42) {\n"
+//                         "   y = 5;\n"
+//                         "   z = 6;\n"
+//                         "}\n"
+//                         "while (y == 5) {\n"
+//                         "   y = 6;\n"
+//                         "   x = z;\n"
+//                         "}\n"
+//                         "repeat {\n"
+//                         "   y = y + 2;\n"
+//                         "   x = x + 3;\n"
+//                         "} until (x > 10) \n";
+//     //"a = factorial(z - 1);\n"
+//     //"y = (x + 2) * 3;\n";
+//
+//
+//
+//     // TODO 8: Add more test cases and read from a file:
+//     /*
+//     const char *invalid_input = "int x;\n"
+//                                 "x = 42;\n"
+//                                 "int x;\n"
+//                                 "x = 42;"
+//                                 "if x == 42) {"
+//                                 "y = 5y;"
+//                                 "z = 6"
+//                                 "}"
+//                                 "int ;";
+// */
+//     printf("Parsing input:\n%s\n", input);
+//     parser_init(input);
+//     ASTNode *ast = parse();
+//
+//     printf("\nAbstract Syntax Tree:\n");
+//     print_ast(ast, 0);
+//
+//     // New: Perform semantic analysis after AST is created
+//     printf("\nPerforming Semantic Analysis...\n");
+//     int semanticResult = analyze_semantics(ast);
+//     if (semanticResult) {
+//         printf("Semantic analysis successful. No errors found.\n");
+//     } else {
+//         printf("Semantic analysis failed. Errors detected.\n");
+//     }
+//
+//     free_ast(ast);
+//
+//     test_case_1();
+//     test_case_2();
+//     return 0;
+// }
+//
+// void test_case_1(void) {
+//     // Valid case
+//     printf("\nTest case 1:\n");
+//     const char *input = "int x;\n x = 10;\n print x; if (x > 4) { x = 5; }";
+//     printf("Parsing input:\n%s\n", input);
+//     parser_init(input);
+//     ASTNode *ast = parse();
+//
+//     printf("\nAbstract Syntax Tree:\n");
+//     print_ast(ast, 0);
+//
+//     free_ast(ast);
+// }
+//
+// void test_case_2(void) {
+//     // Invalid case
+//     printf("\nTest case 2:\n");
+//     const char *input = "int x; print x + ;";
+//     printf("Parsing input:\n%s\n", input);
+//     parser_init(input);
+//     ASTNode *ast = parse();
+//
+//     printf("\nAbstract Syntax Tree:\n");
+//     print_ast(ast, 0);
+//
+//     free_ast(ast);
 // }
\ No newline at end of file
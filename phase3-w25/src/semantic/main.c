@@ -0,0 +1,115 @@
+/* main.c */
+#include <stdio.h>
+#include "../../include/parser.h"
+#include "../../include/semantic.h"
+
+// AST nodes of both test cases come from this arena
+static Arena ast_arena;
+
+void test_case_valid() {
+    const char* input = "int x;\n"
+                        "x = 42;\n"
+                        "if (x > 0) {\n"
+                        "    int y;\n"
+                        "    y = x + 10;\n"
+                        "    print y;\n"
+                        "}\n";
+
+    printf("Parsing input:\n%s\n", input);
+    Parser parser;
+    if (!parser_init(&parser, input)) {
+        printf("Parser Error: out of memory while tokenizing input\n");
+        return;
+    }
+    parser_set_arena(&parser, &ast_arena);
+    ParseResult parsed = parse(&parser);
+    print_parse_diagnostics(&parsed);
+    if (!parsed.ast) {
+        free_parse_result(&parsed);
+        return;
+    }
+    AST *ast = parsed.ast;
+    //
+    // printf("\nAbstract Syntax Tree:\n");
+    // print_ast(ast, ast->root, 0);
+
+    printf("Analyzing input:\n%s\n\n", input);
+
+    // Lexical analysis and parsing
+
+    printf("AST created. Performing semantic analysis...\n\n");
+
+    // Semantic analysis
+    int result = analyze_semantics(ast);
+
+    if (result) {
+        printf("Semantic analysis successful. No errors found.\n");
+    } else {
+        printf("Semantic analysis failed. Errors detected.\n");
+    }
+
+    // Clean up: the result releases the token stream, and the arena keeps
+    // its blocks for the next input
+    free_parse_result(&parsed);
+    arena_reset(&ast_arena);
+}
+
+void test_case_invalid() {
+    const char* input = "x = 42;\n"
+                        "if (x > 0) {\n"
+                        "    int y;\n"
+                        "    y = z + 10;\n"
+                        "    print y;\n"
+                        "}\n";
+
+    printf("Parsing input:\n%s\n", input);
+    Parser parser;
+    if (!parser_init(&parser, input)) {
+        printf("Parser Error: out of memory while tokenizing input\n");
+        return;
+    }
+    parser_set_arena(&parser, &ast_arena);
+    ParseResult parsed = parse(&parser);
+    print_parse_diagnostics(&parsed);
+    if (!parsed.ast) {
+        free_parse_result(&parsed);
+        return;
+    }
+    AST *ast = parsed.ast;
+    //
+    // printf("\nAbstract Syntax Tree:\n");
+    // print_ast(ast, ast->root, 0);
+
+    printf("Analyzing input:\n%s\n\n", input);
+
+    // Lexical analysis and parsing
+
+    printf("AST created. Performing semantic analysis...\n\n");
+
+    // Semantic analysis
+    int result = analyze_semantics(ast);
+
+    if (result) {
+        printf("Semantic analysis successful. No errors found.\n");
+    } else {
+        printf("Semantic analysis failed. Errors detected.\n");
+    }
+
+    // Clean up: the result releases the token stream, and the arena keeps
+    // its blocks for the next input
+    free_parse_result(&parsed);
+    arena_reset(&ast_arena);
+
+}
+
+int main() {
+    arena_init(&ast_arena, 0);
+
+    printf("Invalid test case:\n");
+    test_case_invalid();
+
+    printf("\n\n\n\n\nValid test case:\n");
+    test_case_valid();
+
+    arena_free(&ast_arena);
+}
@@ -1,484 +1,610 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include "../../include/parser.h"
-#include "../../include/lexer.h"
-#include "../../include/tokens.h"
-#include "../../include/semantic.h"
-
-
-void semantic_error(SemanticErrorType error, const char* name, int line) {
-    printf("Semantic Error at line %d: ", line);
-    
-    switch (error) {
-        case SEM_ERROR_UNDECLARED_VARIABLE:
-            printf("Undeclared variable '%s'\n", name);
-            break;
-        case SEM_ERROR_REDECLARED_VARIABLE:
-            printf("Variable '%s' already declared in this scope\n", name);
-            break;
-        case SEM_ERROR_TYPE_MISMATCH:
-            printf("Type mismatch involving '%s'\n", name);
-            break;
-        case SEM_ERROR_UNINITIALIZED_VARIABLE:
-            printf("Variable '%s' may be used uninitialized\n", name);
-            break;
-        case SEM_ERROR_INVALID_OPERATION:
-            printf("Invalid operation involving '%s'\n", name);
-            break;
-        default:
-            printf("Unknown semantic error with '%s'\n", name);
-    }
-}
-
-// Initialize a new symbol table
-// Creates an empty symbol table structure with scope level set to 0
-SymbolTable* init_symbol_table() {
-    SymbolTable* table = malloc(sizeof(SymbolTable));
-    if (table) {
-        table->head = NULL;
-        table->current_scope = 0;
-    }
-    return table;
-}
-
-// Add symbol to table
-void add_symbol(SymbolTable* table, const char* name, int type, int line) {
-    Symbol* symbol = malloc(sizeof(Symbol));
-    if (symbol) {
-        strcpy(symbol->name, name);
-        symbol->type = type;
-        symbol->scope_level = table->current_scope;
-        symbol->line_declared = line;
-        symbol->is_initialized = 0;
-
-        // Add to beginning of list
-        symbol->next = table->head;
-        table->head = symbol;
-    }
-}
-
-// Look up symbol by name
-Symbol* lookup_symbol(SymbolTable* table, const char* name) {
-    Symbol* current = table->head;
-    while (current) {
-        if (strcmp(current->name, name) == 0) {
-            return current;
-        }
-        current = current->next;
-    }
-    return NULL;
-}
-
-// Look up symbol in current scope only
-Symbol* lookup_symbol_current_scope(SymbolTable* table, const char* name) {
-    Symbol* current = table->head;
-    while (current) {
-        if (strcmp(current->name, name) == 0 &&
-            current->scope_level == table->current_scope) {
-            return current;
-        }
-        current = current->next;
-    }
-    return NULL;
-}
-
-// Enter a new scope level
-// Increments the current scope level when entering a block (e.g., if, while)
-void enter_scope(SymbolTable* table){
-    table->current_scope = (table->current_scope + 1);
-}
-
-// Remove symbols from the current scope
-// Cleans up symbols that are no longer accessible after leaving a scope
-void remove_symbols_in_current_scope(SymbolTable* table){
-    Symbol *prev;
-    Symbol *curr;
-    Symbol *next;
-
-    // Are there any symbols?
-    if (!(table->head)){
-        return;
-    }
-
-    // Special case: table head is being removed
-    curr = table->head;
-    while (curr->scope_level == table->current_scope){
-        next = curr->next;
-        free(curr);
-        curr = next;
-        table->head = curr;
-    }
-
-    // Are there any symbols left?
-    if (!(table->head)){
-        return;
-    }
-
-    // Regular case
-    curr = table->head; // Known to be in a broader scope
-    while (curr->next){ // Only triggers if |table| > 1
-
-        // Remove symbol of current scope and adjust links
-        if (curr->scope_level == table->current_scope){
-            next = curr->next;
-            free(curr);
-            curr = next;
-            prev->next = curr;
-        }
-
-        // Shift further down the list
-        // Will always happen during the first loop
-        else {
-            prev = curr;
-            curr = curr->next;
-        }
-    }
-
-    // Special case: the last symbol is being removed
-    if (curr->scope_level == table->current_scope){
-        prev->next=NULL;
-        free(curr);
-    }
-}
-
-
-// Exit the current scope
-// Decrements the current scope level when leaving a block
-// Optionally removes symbols that are no longer in scope
-void exit_scope(SymbolTable* table){
-    remove_symbols_in_current_scope(table);
-    table->current_scope = (table->current_scope) - 1;
-}
-
-
-
-// Free the symbol table memory
-// Releases all allocated memory when the symbol table is no longer needed
-void free_symbol_table(SymbolTable* table){
-    Symbol *curr = table->head;
-    Symbol *next;
-
-    // Clear the table's symbols
-    while (curr){
-        next = curr->next;
-        free(curr);
-        curr = next;
-    }
-
-    // Clear the table itself
-    free(table);
-}
-
-
-int check_statement(ASTNode* node, SymbolTable* table) {
-    // Null nodes are valid
-    if (node == NULL) {
-        return 1; // Empty node is valid
-    }
-
-    switch (node->type) {
-        case AST_VARDECL:
-            return check_declaration(node, table);
-        case AST_ASSIGN:
-            return check_assignment(node, table);
-        case AST_PRINT:
-            return check_expression(node->left, table);
-        case AST_IF: {
-            int condition_result = check_condition(node->left, table);
-            int branch_result = check_statement(node->right, table);
-            return condition_result && branch_result;
-        }
-        case AST_WHILE:{
-            int condition_result = check_condition(node->left, table);
-            int branch_result = check_statement(node->right, table);
-            return condition_result && branch_result;
-        }
-        case AST_BLOCK: {
-            int left_result = 1;
-            if (node->left) {
-                left_result = check_statement(node->left, table);
-            }
-
-            int right_result = 1;
-            if (node->left) {
-                right_result = check_statement(node->right, table);
-            }
-
-            return left_result && right_result;
-
-        }
-        case AST_REPEAT: {
-            // Check statement and condition
-            int statement_result = check_statement(node->left, table);
-            int condition_result = check_condition(node->right, table);
-            return statement_result && condition_result;
-        }
-        default:
-            semantic_error(SEM_ERROR_INVALID_OPERATION, node->token.lexeme, node->token.line);
-        return 0; // Unknown statement type
-    }
-}
-
-// Check program node
-int check_program(ASTNode* node, SymbolTable* table) {
-    if (!node) return 1;
-    
-    int result = 1;
-    
-    if (node->type == AST_PROGRAM) {
-        // Check left child (statement)
-        if (node->left) {
-            result = check_statement(node->left, table) && result;
-        }
-        
-        // Check right child (rest of program)
-        if (node->right) {
-            result = check_program(node->right, table) && result;
-        }
-    }
-    
-    return result;
-}
-
-// Analyze AST semantically
-int analyze_semantics(ASTNode* ast) {
-    SymbolTable* table = init_symbol_table();
-    int result = check_program(ast, table);
-    free_symbol_table(table);
-    return result;
-}
-
-
-// Check declaration node
-int check_declaration(ASTNode* node, SymbolTable* table) {
-    if (node->type != AST_VARDECL) {
-        return 0;
-    }
-
-    const char* name = node->token.lexeme;
-
-    // Check if variable already declared in current scope
-    Symbol* existing = lookup_symbol_current_scope(table, name);
-    if (existing) {
-        semantic_error(SEM_ERROR_REDECLARED_VARIABLE, name, node->token.line);
-        return 0;
-    }
-
-    // Add to symbol table
-    add_symbol(table, name, TOKEN_INT, node->token.line);
-    return 1;
-}
-
-
-// Check an expression for type correctness
-int check_expression(ASTNode* node, SymbolTable* table){
-    // empty node is invalid expression
-    if (node == NULL) {
-        return 0; 
-    }
-
-    switch (node->type) {
-        // Numbers are valid expressions
-        case AST_NUMBER:
-            return TOKEN_INT;
-        // Identifiers are valid expressions if they are declared
-        case AST_IDENTIFIER: {
-            // Check if variable has already been declared
-            Symbol* symbol = lookup_symbol(table, node->token.lexeme);
-            if (!symbol) {
-                semantic_error(SEM_ERROR_UNDECLARED_VARIABLE, node->token.lexeme, node->token.line);
-                return 0;
-            }
-            // Check if variable has not been previously initialized
-            else if (!symbol->is_initialized) {
-                semantic_error(SEM_ERROR_UNINITIALIZED_VARIABLE, node->token.lexeme, node->token.line);
-                return 0; 
-            }
-            else {
-                // Return the type of the expression
-                return symbol->type;
-            }
-        }
-        case AST_BINOP:
-            // recursively check left and right expressions
-            int left_valid = check_expression(node->left, table);
-            int right_valid = check_expression(node->right, table);
-            // Check if left and right side of the binary operation are valid
-            if (left_valid == 0 || right_valid == 0) {
-                return 0; 
-            } 
-            if (left_valid != right_valid) {
-                semantic_error(SEM_ERROR_TYPE_MISMATCH, node->token.lexeme, node->token.line);
-                return 0; 
-            }
-            // Return the type of the expression
-            return left_valid; 
-        case AST_FACTORIAL:
-            // Check if the factorial expression is valid
-            int is_int = check_expression(node->left, table);
-
-            // Expression should be an integer
-            if (is_int != TOKEN_INT) {
-                semantic_error(SEM_ERROR_TYPE_MISMATCH, node->token.lexeme, node->token.line);
-                return 0; 
-            }
-
-            // Factorial should return an integer
-            return TOKEN_INT;
-        default:
-            semantic_error(SEM_ERROR_INVALID_OPERATION, node->token.lexeme, node->token.line);
-            return 0;
-    }
-}
-
-// Check assignment node
-int check_assignment(ASTNode* node, SymbolTable* table) {
-    if (node->type != AST_ASSIGN || !node->left || !node->right) {
-        return 0;
-    }
-
-    const char* name = node->left->token.lexeme;
-
-    // Check if variable exists
-    Symbol* symbol = lookup_symbol(table, name);
-    if (!symbol) {
-        semantic_error(SEM_ERROR_UNDECLARED_VARIABLE, name, node->token.line);
-        return 0;
-    }
-
-    // Check expression
-    int expr_valid = check_expression(node->right, table);
-
-    // Mark as initialized
-    if (expr_valid) {
-        symbol->is_initialized = 1;
-    }
-
-    return expr_valid;
-}
-
-// Check a condition (e.g., in if statements)
-int check_condition(ASTNode* node, SymbolTable* table){
-    // Null node is invalid
-    if (node == NULL) {
-        return 0;
-    }
-
-    // Check the condition expression
-    int result = check_expression(node, table);
-
-    // s if the expression is valid
-    if (result == 0) {
-        return 0;
-    }
-
-    // conditions must be an integer
-    if (result != TOKEN_INT) {
-        semantic_error(SEM_ERROR_TYPE_MISMATCH, node->token.lexeme, node->token.line);
-        return 0;
-    }
-
-    return 1;
-}
-
-// Check a block of statements, handling scope
-int check_block(ASTNode* node, SymbolTable* table){
-    // Added null check to end recursion
-    if (node == NULL) {
-        return 1;
-    }
-    if (node->type != AST_BLOCK) {
-        return 0;
-    }
-
-    // Enter new scope
-    enter_scope(table);
-
-    // Left side: check the first statement in the block
-    // Right side: check the rest of the block
-    int result = check_statement(node->left, table) && check_block(node->right, table);
-
-    // Exit scope
-    exit_scope(table);
-
-    return result;
-}
-
-void test_case_valid() {
-    const char* input = "int x;\n"
-                        "x = 42;\n"
-                        "if (x > 0) {\n"
-                        "    int y;\n"
-                        "    y = x + 10;\n"
-                        "    print y;\n"
-                        "}\n";
-
-    printf("Parsing input:\n%s\n", input);
-    parser_init(input);
-    ASTNode *ast = parse();
-    //
-    // printf("\nAbstract Syntax Tree:\n");
-    // print_ast(ast, 0);
-
-    printf("Analyzing input:\n%s\n\n", input);
-
-    // Lexical analysis and parsing
-
-    printf("AST created. Performing semantic analysis...\n\n");
-
-    // Semantic analysis
-    int result = analyze_semantics(ast);
-
-    if (result) {
-        printf("Semantic analysis successful. No errors found.\n");
-    } else {
-        printf("Semantic analysis failed. Errors detected.\n");
-    }
-
-    // Clean up
-    free_ast(ast);
-}
-
-void test_case_invalid() {
-    const char* input = "x = 42;\n"
-                        "if (x > 0) {\n"
-                        "    int y;\n"
-                        "    y = z + 10;\n"
-                        "    print y;\n"
-                        "}\n";
-
-    printf("Parsing input:\n%s\n", input);
-    parser_init(input);
-    ASTNode *ast = parse();
-    //
-    // printf("\nAbstract Syntax Tree:\n");
-    // print_ast(ast, 0);
-
-    printf("Analyzing input:\n%s\n\n", input);
-
-    // Lexical analysis and parsing
-
-    printf("AST created. Performing semantic analysis...\n\n");
-
-    // Semantic analysis
-    int result = analyze_semantics(ast);
-
-    if (result) {
-        printf("Semantic analysis successful. No errors found.\n");
-    } else {
-        printf("Semantic analysis failed. Errors detected.\n");
-    }
-
-    // Clean up
-    free_ast(ast);
-
-}
-
-int main() {
-    printf("Invalid test case:\n");
-    test_case_invalid();
-
-    printf("\n\n\n\n\nValid test case:\n");
-    test_case_valid();
-}
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/parser.h"
+#include "../../include/lexer.h"
+#include "../../include/tokens.h"
+#include "../../include/semantic.h"
+
+
+void semantic_error(SemanticErrorType error, const char* name, int length, int line) {
+    printf("Semantic Error at line %d: ", line);
+    
+    switch (error) {
+        case SEM_ERROR_UNDECLARED_VARIABLE:
+            printf("Undeclared variable '%.*s'\n", length, name);
+            break;
+        case SEM_ERROR_REDECLARED_VARIABLE:
+            printf("Variable '%.*s' already declared in this scope\n", length, name);
+            break;
+        case SEM_ERROR_TYPE_MISMATCH:
+            printf("Type mismatch involving '%.*s'\n", length, name);
+            break;
+        case SEM_ERROR_UNINITIALIZED_VARIABLE:
+            printf("Variable '%.*s' may be used uninitialized\n", length, name);
+            break;
+        case SEM_ERROR_INVALID_OPERATION:
+            printf("Invalid operation involving '%.*s'\n", length, name);
+            break;
+        default:
+            printf("Unknown semantic error with '%.*s'\n", length, name);
+    }
+}
+
+// Entries in a new symbol table's hash table, and symbols on its stack
+#define SYMBOL_TABLE_ENTRIES 64
+#define SYMBOL_TABLE_SYMBOLS 64
+
+// Allocate a hash table of `capacity` empty entries
+static SymbolEntry* new_entries(int capacity) {
+    SymbolEntry* entries = malloc(capacity * sizeof(SymbolEntry));
+    if (entries) {
+        for (int i = 0; i < capacity; i++) {
+            entries[i].name_id = -1;
+            entries[i].symbol = -1;
+        }
+    }
+    return entries;
+}
+
+// Initialize a new symbol table
+// Creates an empty symbol table structure with scope level set to 0
+SymbolTable* init_symbol_table(const AST* ast) {
+    SymbolTable* table = malloc(sizeof(SymbolTable));
+    if (table) {
+        table->symbols = malloc(SYMBOL_TABLE_SYMBOLS * sizeof(Symbol));
+        table->symbol_count = 0;
+        table->symbol_capacity = SYMBOL_TABLE_SYMBOLS;
+        table->entries = new_entries(SYMBOL_TABLE_ENTRIES);
+        table->entry_count = 0;
+        table->entry_capacity = SYMBOL_TABLE_ENTRIES;
+        table->current_scope = 0;
+        table->frame_peak = 0;
+        table->names = NULL;
+        table->statement = 0;
+        table->next_use = 0;
+        table->out_of_memory = 0;
+        table->ast = ast;
+        table->source = ast->source;
+        if (!table->symbols || !table->entries) {
+            free(table->symbols);
+            free(table->entries);
+            free(table);
+            return NULL;
+        }
+        line_index_init(&table->lines, ast->source);
+    }
+    return table;
+}
+
+// Line of a node's token, for error messages
+static int node_line(SymbolTable* table, NodeId node) {
+    return line_index_line(&table->lines, ast_token(table->ast, node).offset);
+}
+
+// Report an error about the lexeme of a token
+static void token_error(SemanticErrorType error, SymbolTable* table, int index) {
+    Token token = token_at(table->ast->stream, index);
+    semantic_error(error, token_lexeme(table->source, token), token.length,
+                   line_index_line(&table->lines, token.offset));
+}
+
+// Report an error about the lexeme of a node's token
+static void node_error(SemanticErrorType error, SymbolTable* table, NodeId node) {
+    token_error(error, table, table->ast->tokens[node]);
+}
+
+// Make `node` the statement whose expressions are checked next; the
+// first of them starts at or after token `from`
+static void enter_statement(SymbolTable* table, NodeId node, int from) {
+    table->statement = node;
+    table->next_use = from;
+}
+
+// Token of the use of an expression node that is being checked. In a
+// hash-consed tree a shared node only has the token of its first
+// occurrence. Expression nodes are checked in source order, so the token
+// of this use is the first one with the same text from next_use on.
+static int use_token(SymbolTable* table, NodeId node) {
+    const AST* ast = table->ast;
+    int index = ast->tokens[node];
+    if (!ast->shared || !table->statement) {
+        return index;
+    }
+    int end = ast->ends[table->statement];
+    if (index < table->next_use || index >= end) {
+        Token token = token_at(ast->stream, index);
+        const char* text = token_lexeme(table->source, token);
+        for (int i = table->next_use; i < end; i++) {
+            Token use = token_at(ast->stream, i);
+            if (use.type == token.type && use.length == token.length &&
+                memcmp(token_lexeme(table->source, use), text, token.length) == 0) {
+                index = i;
+                break;
+            }
+        }
+    }
+    if (index >= table->next_use && index < end) {
+        table->next_use = index + 1;
+    }
+    return index;
+}
+
+// Name ids are dense; multiplying by an odd constant spreads them over
+// the table
+static unsigned hash_id(int name_id) {
+    return (unsigned)name_id * 2654435769u;
+}
+
+// Entry of a name, or the empty entry where it would go
+static SymbolEntry* find_entry(SymbolEntry* entries, int capacity, int name_id) {
+    unsigned slot = hash_id(name_id) & (capacity - 1);
+    while (entries[slot].name_id != -1 && entries[slot].name_id != name_id) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    return &entries[slot];
+}
+
+// Double the hash table and reinsert every name
+static int grow_entries(SymbolTable* table) {
+    int capacity = table->entry_capacity * 2;
+    SymbolEntry* entries = new_entries(capacity);
+    if (!entries) {
+        return 0;
+    }
+    for (int i = 0; i < table->entry_capacity; i++) {
+        if (table->entries[i].name_id != -1) {
+            *find_entry(entries, capacity, table->entries[i].name_id) = table->entries[i];
+        }
+    }
+    free(table->entries);
+    table->entries = entries;
+    table->entry_capacity = capacity;
+    return 1;
+}
+
+// Names the lexer could not intern have id -1, which the hash table uses
+// for empty entries, so they are never looked up. Returns 0 for those.
+static int known_name(SymbolTable* table, int name_id) {
+    if (name_id < 0) {
+        table->out_of_memory = 1;
+        return 0;
+    }
+    return 1;
+}
+
+// Add symbol to table
+// Names are interned by the lexer, so a symbol only keeps the id. The new
+// symbol goes on top of the symbol stack and of its name's shadow chain.
+void add_symbol(SymbolTable* table, int name_id, int type, int offset) {
+    if (table->symbol_count == table->symbol_capacity) {
+        int capacity = table->symbol_capacity * 2;
+        Symbol* symbols = realloc(table->symbols, capacity * sizeof(Symbol));
+        if (!symbols) {
+            return;
+        }
+        table->symbols = symbols;
+        table->symbol_capacity = capacity;
+    }
+
+    SymbolEntry* entry = find_entry(table->entries, table->entry_capacity, name_id);
+    if (entry->name_id == -1) {
+        // Keep the hash table at most half full. Entries are never
+        // removed, so lookups need no tombstones.
+        if ((table->entry_count + 1) * 2 > table->entry_capacity) {
+            if (!grow_entries(table)) {
+                return;
+            }
+            entry = find_entry(table->entries, table->entry_capacity, name_id);
+        }
+        entry->name_id = name_id;
+        entry->symbol = -1;
+        table->entry_count++;
+    }
+
+    Symbol* symbol = &table->symbols[table->symbol_count];
+    symbol->name_id = name_id;
+    symbol->type = type;
+    symbol->scope_level = table->current_scope;
+    symbol->declared_at = offset;
+    symbol->is_initialized = 0;
+    symbol->shadowed = entry->symbol;
+    entry->symbol = table->symbol_count++;
+    if (table->symbol_count > table->frame_peak) {
+        table->frame_peak = table->symbol_count;
+    }
+}
+
+// Look up symbol by name: the innermost declaration in scope
+Symbol* lookup_symbol(SymbolTable* table, int name_id) {
+    int symbol = find_entry(table->entries, table->entry_capacity, name_id)->symbol;
+    return symbol >= 0 ? &table->symbols[symbol] : NULL;
+}
+
+// Look up symbol in current scope only
+Symbol* lookup_symbol_current_scope(SymbolTable* table, int name_id) {
+    Symbol* symbol = lookup_symbol(table, name_id);
+    if (symbol && symbol->scope_level == table->current_scope) {
+        return symbol;
+    }
+    return NULL;
+}
+
+// Record that a name node refers to a symbol: its frame slot is the
+// symbol's position on the stack
+static void resolve(SymbolTable* table, NodeId node, const Symbol* symbol) {
+    if (table->names) {
+        table->names->slots[node] = (int)(symbol - table->symbols);
+        table->names->depths[node] = symbol->scope_level;
+    }
+}
+
+// Start measuring the frame of a sequence node. Returns the peak of the
+// enclosing sequence, for end_frame().
+static int begin_frame(SymbolTable* table) {
+    int outer = table->frame_peak;
+    table->frame_peak = table->symbol_count;
+    return outer;
+}
+
+// Record the frame size of a sequence node and fold it into the
+// enclosing sequence's peak
+static void end_frame(SymbolTable* table, NodeId node, int outer) {
+    if (table->names) {
+        table->names->frame_sizes[node] = table->frame_peak;
+    }
+    if (outer > table->frame_peak) {
+        table->frame_peak = outer;
+    }
+}
+
+// Enter a new scope level
+// Increments the current scope level when entering a block (e.g., if, while)
+void enter_scope(SymbolTable* table){
+    table->current_scope = (table->current_scope + 1);
+}
+
+// Remove symbols from the current scope
+// Pops the symbol stack back to the scope's watermark: only the scope's
+// own symbols are touched, and each name's entry goes back to the
+// declaration its symbol shadowed
+void remove_symbols_in_current_scope(SymbolTable* table){
+    int top = table->symbol_count;
+    while (top > 0 && table->symbols[top - 1].scope_level == table->current_scope) {
+        const Symbol* symbol = &table->symbols[--top];
+        find_entry(table->entries, table->entry_capacity, symbol->name_id)->symbol = symbol->shadowed;
+    }
+    table->symbol_count = top;
+}
+
+
+// Exit the current scope
+// Decrements the current scope level when leaving a block
+// Optionally removes symbols that are no longer in scope
+void exit_scope(SymbolTable* table){
+    remove_symbols_in_current_scope(table);
+    table->current_scope = (table->current_scope) - 1;
+}
+
+
+
+// Free the symbol table memory
+// Releases all allocated memory when the symbol table is no longer needed
+void free_symbol_table(SymbolTable* table){
+    // The symbols are one block
+    free(table->symbols);
+    free(table->entries);
+    line_index_free(&table->lines);
+    free(table);
+}
+
+
+int check_statement(NodeId node, SymbolTable* table) {
+    // Null nodes are valid
+    if (!node) {
+        return 1; // Empty node is valid
+    }
+
+    const AST* ast = table->ast;
+    enter_statement(table, node, ast->starts[node]);
+    switch (ast_kind(ast, node)) {
+        case AST_VARDECL:
+            return check_declaration(node, table);
+        case AST_ASSIGN:
+            return check_assignment(node, table);
+        case AST_PRINT:
+            return check_expression(ast->left[node], table);
+        case AST_IF: {
+            int condition_result = check_condition(ast->left[node], table);
+            int branch_result = check_statement(ast->right[node], table);
+            return condition_result && branch_result;
+        }
+        case AST_WHILE:{
+            int condition_result = check_condition(ast->left[node], table);
+            int branch_result = check_statement(ast->right[node], table);
+            return condition_result && branch_result;
+        }
+        case AST_BLOCK: {
+            // Check every statement, even after one fails
+            const NodeId* children = ast_children(ast, node);
+            int result = 1;
+            int outer = begin_frame(table);
+            for (int i = 0; i < ast_child_count(ast, node); i++) {
+                result = check_statement(children[i], table) && result;
+            }
+            end_frame(table, node, outer);
+            return result;
+        }
+        case AST_REPEAT: {
+            // Check statement and condition
+            int statement_result = check_statement(ast->left[node], table);
+            // The condition comes after the body
+            enter_statement(table, node, ast->left[node] ? ast->ends[ast->left[node]] : ast->starts[node]);
+            int condition_result = check_condition(ast->right[node], table);
+            return statement_result && condition_result;
+        }
+        default:
+            node_error(SEM_ERROR_INVALID_OPERATION, table, node);
+        return 0; // Unknown statement type
+    }
+}
+
+// Check program node
+int check_program(NodeId node, SymbolTable* table) {
+    if (!node) return 1;
+    
+    const AST* ast = table->ast;
+    int result = 1;
+    
+    if (ast_kind(ast, node) == AST_PROGRAM) {
+        // Top-level statements are checked in a loop, so long programs
+        // don't need a deep stack
+        const NodeId* children = ast_children(ast, node);
+        int outer = begin_frame(table);
+        for (int i = 0; i < ast_child_count(ast, node); i++) {
+            result = check_statement(children[i], table) && result;
+        }
+        end_frame(table, node, outer);
+    }
+    
+    return result;
+}
+
+// Check a tree, recording resolved names in `names` if it is not NULL
+static int analyze(const AST* ast, NameResolution* names) {
+    SymbolTable* table = init_symbol_table(ast);
+    if (!table) {
+        printf("Semantic Error: out of memory\n");
+        return 0;
+    }
+    table->names = names;
+    int result = check_program(ast->root, table);
+    if (table->out_of_memory) {
+        printf("Semantic Error: out of memory\n");
+        result = 0;
+    }
+    free_symbol_table(table);
+    return result;
+}
+
+// Analyze AST semantically
+int analyze_semantics(const AST* ast) {
+    return analyze(ast, NULL);
+}
+
+// Analyze AST semantically and record, for every identifier, assignment
+// target and declaration the checks reach, the frame slot and scope depth
+// of its declaration, and for every program and block node its frame
+// size. Names the checks skip or cannot resolve keep -1. In a hash-consed
+// tree a shared node keeps the resolution of its last use.
+int resolve_names(const AST* ast, NameResolution* names) {
+    names->count = ast->count;
+    names->slots = malloc(ast->count * sizeof(int));
+    names->depths = malloc(ast->count * sizeof(int));
+    names->frame_sizes = calloc(ast->count, sizeof(int));
+    if (!names->slots || !names->depths || !names->frame_sizes) {
+        free_name_resolution(names);
+        printf("Semantic Error: out of memory\n");
+        return 0;
+    }
+    for (int i = 0; i < ast->count; i++) {
+        names->slots[i] = -1;
+        names->depths[i] = -1;
+    }
+    return analyze(ast, names);
+}
+
+void free_name_resolution(NameResolution* names) {
+    free(names->slots);
+    free(names->depths);
+    free(names->frame_sizes);
+    names->slots = NULL;
+    names->depths = NULL;
+    names->frame_sizes = NULL;
+    names->count = 0;
+}
+
+
+// Check declaration node
+int check_declaration(NodeId node, SymbolTable* table) {
+    if (ast_kind(table->ast, node) != AST_VARDECL) {
+        return 0;
+    }
+
+    Token token = ast_token(table->ast, node);
+    if (!known_name(table, token.id)) {
+        return 0;
+    }
+
+    // Check if variable already declared in current scope
+    Symbol* existing = lookup_symbol_current_scope(table, token.id);
+    if (existing) {
+        node_error(SEM_ERROR_REDECLARED_VARIABLE, table, node);
+        return 0;
+    }
+
+    // Add to symbol table
+    add_symbol(table, token.id, TOKEN_INT, token.offset);
+    Symbol* symbol = lookup_symbol_current_scope(table, token.id);
+    if (symbol) {
+        resolve(table, node, symbol);
+    }
+    return 1;
+}
+
+
+// Check an expression for type correctness
+int check_expression(NodeId node, SymbolTable* table){
+    // empty node is invalid expression
+    if (!node) {
+        return 0; 
+    }
+
+    const AST* ast = table->ast;
+    switch (ast_kind(ast, node)) {
+        // Numbers are valid expressions
+        case AST_NUMBER:
+            use_token(table, node);
+            return TOKEN_INT;
+        // Identifiers are valid expressions if they are declared
+        case AST_IDENTIFIER: {
+            int use = use_token(table, node);
+            if (!known_name(table, ast_token(ast, node).id)) {
+                return 0;
+            }
+            // Check if variable has already been declared
+            Symbol* symbol = lookup_symbol(table, ast_token(ast, node).id);
+            if (!symbol) {
+                token_error(SEM_ERROR_UNDECLARED_VARIABLE, table, use);
+                return 0;
+            }
+            resolve(table, node, symbol);
+            // Check if variable has not been previously initialized
+            if (!symbol->is_initialized) {
+                token_error(SEM_ERROR_UNINITIALIZED_VARIABLE, table, use);
+                return 0; 
+            }
+            else {
+                // Return the type of the expression
+                return symbol->type;
+            }
+        }
+        case AST_BINOP:
+            // recursively check left and right expressions
+            int left_valid = check_expression(ast->left[node], table);
+            int operator_use = use_token(table, node);
+            int right_valid = check_expression(ast->right[node], table);
+            // Check if left and right side of the binary operation are valid
+            if (left_valid == 0 || right_valid == 0) {
+                return 0; 
+            } 
+            if (left_valid != right_valid) {
+                token_error(SEM_ERROR_TYPE_MISMATCH, table, operator_use);
+                return 0; 
+            }
+            // Return the type of the expression
+            return left_valid; 
+        case AST_FACTORIAL:
+            // Check if the factorial expression is valid
+            int factorial_use = use_token(table, node);
+            int is_int = check_expression(ast->left[node], table);
+
+            // Expression should be an integer
+            if (is_int != TOKEN_INT) {
+                token_error(SEM_ERROR_TYPE_MISMATCH, table, factorial_use);
+                return 0; 
+            }
+
+            // Factorial should return an integer
+            return TOKEN_INT;
+        default:
+            node_error(SEM_ERROR_INVALID_OPERATION, table, node);
+            return 0;
+    }
+}
+
+// Check assignment node
+int check_assignment(NodeId node, SymbolTable* table) {
+    const AST* ast = table->ast;
+    if (ast_kind(ast, node) != AST_ASSIGN || !ast->left[node] || !ast->right[node]) {
+        return 0;
+    }
+
+    Token target = ast_token(ast, ast->left[node]);
+    const char* name = token_lexeme(table->source, target);
+    int length = target.length;
+    if (!known_name(table, target.id)) {
+        return 0;
+    }
+
+    // Check if variable exists
+    Symbol* symbol = lookup_symbol(table, target.id);
+    if (!symbol) {
+        semantic_error(SEM_ERROR_UNDECLARED_VARIABLE, name, length, node_line(table, node));
+        return 0;
+    }
+    resolve(table, ast->left[node], symbol);
+
+    // Check expression, which starts after the target and '='
+    table->next_use = ast->ends[ast->left[node]];
+    int expr_valid = check_expression(ast->right[node], table);
+
+    // Mark as initialized
+    if (expr_valid) {
+        symbol->is_initialized = 1;
+    }
+
+    return expr_valid;
+}
+
+// Check a condition (e.g., in if statements)
+int check_condition(NodeId node, SymbolTable* table){
+    // Null node is invalid
+    if (!node) {
+        return 0;
+    }
+
+    // Check the condition expression
+    int result = check_expression(node, table);
+
+    // s if the expression is valid
+    if (result == 0) {
+        return 0;
+    }
+
+    // conditions must be an integer
+    if (result != TOKEN_INT) {
+        node_error(SEM_ERROR_TYPE_MISMATCH, table, node);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Check a block of statements, handling scope
+int check_block(NodeId node, SymbolTable* table){
+    // Added null check to end recursion
+    if (!node) {
+        return 1;
+    }
+    const AST* ast = table->ast;
+    if (ast_kind(ast, node) != AST_BLOCK) {
+        return 0;
+    }
+
+    // Enter new scope
+    enter_scope(table);
+    int outer = begin_frame(table);
+
+    const NodeId* children = ast_children(ast, node);
+    int result = 1;
+    for (int i = 0; i < ast_child_count(ast, node); i++) {
+        result = check_statement(children[i], table) && result;
+    }
+
+    // Exit scope
+    end_frame(table, node, outer);
+    exit_scope(table);
+
+    return result;
+}
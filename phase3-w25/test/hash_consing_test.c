@@ -0,0 +1,109 @@
+/* hash_consing_test.c */
+// Checks that analyze_semantics() reports the same diagnostics, at the
+// same lines, on a hash-consed tree as on the plain tree of the same
+// program. Shared nodes only keep the token of their first occurrence, so
+// this guards against every later use being reported at that line.
+//
+//   gcc -o hash_consing_test test/hash_consing_test.c src/lexer/*.c src/parser/*.c src/semantic/semantic.c -pthread
+//   ./hash_consing_test
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/parser.h"
+#include "../include/semantic.h"
+
+static const char* programs[] = {
+    // The same undeclared name on several lines
+    "print y;\n"
+    "\n"
+    "print y;\n"
+    "\n"
+    "print y;\n"
+    "print y;\n",
+
+    // Shared identifiers, operators and factorials in conditions and
+    // bodies, including a repeat condition after its body
+    "int y;\n"
+    "int z;\n"
+    "repeat {\n"
+    "  print (z + y);\n"
+    "} until (\n"
+    "  z + y);\n"
+    "if (z\n"
+    " > factorial(y)) { print\n"
+    " factorial(y); }\n"
+    "while (z + y) {\n"
+    "  z = z + y;\n"
+    "}\n",
+
+    // Redeclarations and assignments to undeclared names
+    "int a;\n"
+    "a = b + 1;\n"
+    "{\n"
+    "  int a;\n"
+    "  int a;\n"
+    "  a = b + 1;\n"
+    "}\n"
+    "c = a;\n"
+    "c = a;\n",
+};
+
+// Analyze `input` and return what analyze_semantics() printed
+static char* analyze_output(const char* input, int hash_consing) {
+    Parser parser;
+    if (!parser_init(&parser, input)) {
+        return NULL;
+    }
+    parser_set_hash_consing(&parser, hash_consing);
+    ParseResult parsed = parse(&parser);
+    if (!parsed.ast) {
+        free_parse_result(&parsed);
+        return NULL;
+    }
+
+    FILE* capture = tmpfile();
+    if (!capture) {
+        free_parse_result(&parsed);
+        return NULL;
+    }
+    fflush(stdout);
+    int saved = dup(1);
+    dup2(fileno(capture), 1);
+    analyze_semantics(parsed.ast);
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+    free_parse_result(&parsed);
+
+    long length = ftell(capture);
+    char* text = calloc(length + 1, 1);
+    rewind(capture);
+    if (text && fread(text, 1, length, capture) != (size_t)length) {
+        free(text);
+        text = NULL;
+    }
+    fclose(capture);
+    return text;
+}
+
+int main() {
+    int count = sizeof(programs) / sizeof(programs[0]);
+    int failures = 0;
+    for (int i = 0; i < count; i++) {
+        char* plain = analyze_output(programs[i], 0);
+        char* shared = analyze_output(programs[i], 1);
+        if (!plain || !shared) {
+            printf("program %d: out of memory\n", i);
+            failures++;
+        } else if (strcmp(plain, shared) != 0) {
+            printf("program %d: diagnostics differ\n--- plain tree\n%s--- hash-consed tree\n%s",
+                   i, plain, shared);
+            failures++;
+        }
+        free(plain);
+        free(shared);
+    }
+    printf("%d programs checked, %d failed\n", count, failures);
+    return failures != 0;
+}
@@ -0,0 +1,352 @@
+/* parse_modes_test.c */
+// Differential check of the parser's other modes against parse(). Random
+// programs, with syntax errors mixed in, are parsed with parse() and with
+//   - reparse(), after each of a series of random edits,
+//   - the push parser, fed in chunks of random size,
+//   - the pipelined parser, and
+//   - parse_parallel(), on programs large enough to be split,
+// and each must give the same tree, tokens and diagnostics.
+//
+//   gcc -O2 -o parse_modes_test test/parse_modes_test.c src/lexer/*.c src/parser/*.c -pthread
+//   ./parse_modes_test [programs] [seed]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/parser.h"
+#include "../include/lexer.h"
+
+// Source being generated
+typedef struct {
+    char* text;
+    int length;
+    int capacity;
+} Program;
+
+static void append(Program* program, const char* text) {
+    int length = (int)strlen(text);
+    if (program->length + length + 1 > program->capacity) {
+        program->capacity = (program->length + length + 1) * 2;
+        program->text = realloc(program->text, program->capacity);
+        if (!program->text) {
+            printf("out of memory\n");
+            exit(1);
+        }
+    }
+    memcpy(program->text + program->length, text, length + 1);
+    program->length += length;
+}
+
+static const char* names[] = {"x", "y", "zz", "abc"};
+static const char* operators[] = {"+", "-", "*", "/", "<", ">", "==", "<=", ">="};
+
+// Tokens that break statements when dropped in between them
+static const char* junk[] = {"x", "1", "+", "-", "*", " ", "\n", ";", "{", "}",
+                             "(", ")", "int ", "@", "until", "repeat"};
+
+static void generate_expression(Program* program, int depth) {
+    char number[16];
+    switch (rand() % (depth > 3 ? 2 : 6)) {
+        case 0:
+            sprintf(number, "%d", rand() % 100);
+            append(program, number);
+            break;
+        case 1:
+            append(program, names[rand() % 4]);
+            break;
+        case 2:
+            append(program, "(");
+            generate_expression(program, depth + 1);
+            append(program, ")");
+            break;
+        case 3:
+            append(program, "factorial(");
+            generate_expression(program, depth + 1);
+            append(program, ")");
+            break;
+        default:
+            generate_expression(program, depth + 1);
+            append(program, rand() % 2 ? " " : "");
+            append(program, operators[rand() % 9]);
+            append(program, " ");
+            generate_expression(program, depth + 1);
+    }
+}
+
+static void generate_statement(Program* program, int depth);
+
+static void generate_block(Program* program, int depth) {
+    append(program, "{\n");
+    for (int i = rand() % 4; i > 0; i--) {
+        generate_statement(program, depth + 1);
+    }
+    append(program, "}\n");
+}
+
+static void generate_statement(Program* program, int depth) {
+    switch (rand() % (depth > 3 ? 3 : 7)) {
+        case 0:
+            append(program, "int ");
+            append(program, names[rand() % 4]);
+            append(program, ";\n");
+            break;
+        case 1:
+            append(program, names[rand() % 4]);
+            append(program, " = ");
+            generate_expression(program, 0);
+            append(program, ";\n");
+            break;
+        case 2:
+            append(program, "print ");
+            generate_expression(program, 0);
+            append(program, ";\n");
+            break;
+        case 3:
+            append(program, "if (");
+            generate_expression(program, 0);
+            append(program, ") ");
+            generate_block(program, depth);
+            break;
+        case 4:
+            append(program, "while (");
+            generate_expression(program, 0);
+            append(program, ") ");
+            generate_block(program, depth);
+            break;
+        case 5:
+            append(program, "repeat ");
+            generate_block(program, depth);
+            append(program, "until (");
+            generate_expression(program, 0);
+            append(program, rand() % 2 ? ")\n" : ") ");
+            break;
+        default:
+            append(program, junk[rand() % 16]);
+    }
+}
+
+// Program of `statements` top-level statements, sometimes cut short by one
+// byte so the input ends inside a construct
+static Program generate_program(int statements) {
+    Program program = {NULL, 0, 0};
+    append(&program, "");
+    for (int i = 0; i < statements; i++) {
+        generate_statement(&program, 0);
+    }
+    if (program.length > 0 && rand() % 3 == 0) {
+        program.text[--program.length] = '\0';
+    }
+    return program;
+}
+
+static int same_diagnostic(const ParseDiagnostic* a, const ParseDiagnostic* b) {
+    return a->error == b->error && a->token_index == b->token_index && a->unit == b->unit &&
+           a->line == b->line && a->column == b->column && a->token.type == b->token.type &&
+           a->token.offset == b->token.offset && a->token.length == b->token.length;
+}
+
+// What differs between two parses of the same source (NULL: nothing)
+static const char* compare(const ParseResult* a, const ParseResult* b) {
+    if (!a->ast || !b->ast || a->out_of_memory || b->out_of_memory) {
+        return "out of memory";
+    }
+    const AST* x = a->ast;
+    const AST* y = b->ast;
+    if (x->count != y->count || x->list_count != y->list_count || x->root != y->root) {
+        return "tree size";
+    }
+    if (memcmp(x->kinds, y->kinds, x->count) != 0 ||
+        memcmp(x->tokens, y->tokens, x->count * sizeof(int)) != 0 ||
+        memcmp(x->starts, y->starts, x->count * sizeof(int)) != 0 ||
+        memcmp(x->ends, y->ends, x->count * sizeof(int)) != 0 ||
+        memcmp(x->left, y->left, x->count * sizeof(NodeId)) != 0 ||
+        memcmp(x->right, y->right, x->count * sizeof(NodeId)) != 0 ||
+        memcmp(x->lists, y->lists, x->list_count * sizeof(NodeId)) != 0) {
+        return "tree";
+    }
+
+    const TokenStream* s = x->stream;
+    const TokenStream* t = y->stream;
+    if (s->count != t->count) {
+        return "token count";
+    }
+    for (int i = 0; i < s->count; i++) {
+        if (s->types[i] != t->types[i] || s->offsets[i] != t->offsets[i] ||
+            s->lengths[i] != t->lengths[i] || s->errors[i] != t->errors[i] ||
+            s->ops[i] != t->ops[i]) {
+            return "tokens";
+        }
+    }
+
+    if (a->diagnostic_count != b->diagnostic_count) {
+        return "diagnostic count";
+    }
+    for (int i = 0; i < a->diagnostic_count; i++) {
+        if (!same_diagnostic(&a->diagnostics[i], &b->diagnostics[i])) {
+            return "diagnostics";
+        }
+    }
+    return NULL;
+}
+
+static ParseResult parse_source(const char* source, int hash_consing) {
+    Parser parser;
+    if (!parser_init(&parser, source)) {
+        printf("out of memory\n");
+        exit(1);
+    }
+    parser_set_hash_consing(&parser, hash_consing);
+    return parse(&parser);
+}
+
+static int failures;
+
+static void report(const char* mode, int program, const char* difference, const char* source) {
+    if (failures++ < 5) {
+        printf("%s, program %d: %s differs from parse()\n---\n%s\n---\n", mode, program,
+               difference, source);
+    }
+}
+
+// Snippets inserted by random edits
+static const char* snippets[] = {
+    "", "x", "1", "+", "-", "*", " ", "\n", ";", "{", "}", "(", ")", "int ", "if (",
+    "x = 2;", "print y;", "while (x) { y = 1; }", "repeat { x = 1; } until (y)", "=", "<",
+    "<=", "==", "factorial(", "zz", "7 * ", "} ", "{ int q; ", "@", "abc",
+};
+
+// Apply random edits with reparse() and compare each result with parsing
+// the edited source from scratch
+static void check_reparse(const Program* program, int index, int hash_consing) {
+    int length = program->length;
+    char* source = malloc(length + 1);
+    memcpy(source, program->text, length + 1);
+    ParseResult result = parse_source(source, hash_consing);
+
+    // reparse() keeps pointing into earlier sources, so all are kept
+    char* sources[31];
+    int source_count = 0;
+    sources[source_count++] = source;
+    for (int e = 0; e < 30; e++) {
+        int start = rand() % (length + 1);
+        int removed = rand() % 3 == 0 ? 0 : rand() % 4;
+        if (start + removed > length) {
+            removed = length - start;
+        }
+        const char* text = snippets[rand() % (sizeof(snippets) / sizeof(snippets[0]))];
+        int inserted = (int)strlen(text);
+
+        int new_length = length - removed + inserted;
+        char* edited = malloc(new_length + 1);
+        memcpy(edited, source, start);
+        memcpy(edited + start, text, inserted);
+        memcpy(edited + start + inserted, source + start + removed, length - start - removed + 1);
+        TextEdit edit = {start, start + removed, inserted};
+        if (!reparse(&result, edited, new_length, edit)) {
+            printf("out of memory\n");
+            exit(1);
+        }
+        source = sources[source_count++] = edited;
+        length = new_length;
+
+        ParseResult scratch = parse_source(source, hash_consing);
+        const char* difference = compare(&result, &scratch);
+        free_parse_result(&scratch);
+        if (difference) {
+            report(hash_consing ? "reparse (hash-consed)" : "reparse", index, difference, source);
+            break;
+        }
+    }
+
+    free_parse_result(&result);
+    for (int i = 0; i < source_count; i++) {
+        free(sources[i]);
+    }
+}
+
+// Feed the program to the push parser in chunks of 1 byte, up to 8 bytes
+// or up to 64 bytes
+static void check_push(const Program* program, int index, const ParseResult* expected) {
+    PushParser push;
+    if (!parser_init_push(&push, NULL, NULL)) {
+        printf("out of memory\n");
+        exit(1);
+    }
+    int most = (int[]){1, 8, 64}[rand() % 3];
+    for (int at = 0; at < program->length;) {
+        int chunk = 1 + rand() % most;
+        if (at + chunk > program->length) {
+            chunk = program->length - at;
+        }
+        parser_feed(&push, program->text + at, chunk);
+        at += chunk;
+    }
+    ParseResult result = parser_finish(&push);
+    const char* difference = compare(&result, expected);
+    if (difference) {
+        report("push", index, difference, program->text);
+    }
+    free_parse_result(&result);
+}
+
+static void check_pipelined(const Program* program, int index, const ParseResult* expected) {
+    Parser parser;
+    if (!parser_init_pipelined(&parser, program->text)) {
+        printf("out of memory\n");
+        exit(1);
+    }
+    ParseResult result = parse(&parser);
+    const char* difference = compare(&result, expected);
+    if (difference) {
+        report("pipelined", index, difference, program->text);
+    }
+    free_parse_result(&result);
+}
+
+static void check_parallel(const Program* program, int index, const ParseResult* expected,
+                           int threads) {
+    Parser parser;
+    if (!parser_init(&parser, program->text)) {
+        printf("out of memory\n");
+        exit(1);
+    }
+    ParseResult result = parse_parallel(&parser, threads);
+    const char* difference = compare(&result, expected);
+    if (difference) {
+        report("parallel", index, difference, "(large program not shown)");
+    }
+    free_parse_result(&result);
+}
+
+int main(int argc, char** argv) {
+    int programs = argc > 1 ? atoi(argv[1]) : 500;
+    unsigned seed = argc > 2 ? (unsigned)atoi(argv[2]) : 1;
+    srand(seed);
+
+    for (int i = 0; i < programs; i++) {
+        Program program = generate_program(1 + rand() % 30);
+        ParseResult expected = parse_source(program.text, 0);
+        check_reparse(&program, i, i % 2);
+        check_push(&program, i, &expected);
+        check_pipelined(&program, i, &expected);
+        free_parse_result(&expected);
+        free(program.text);
+    }
+
+    // parse_parallel() only splits inputs with 64K tokens per thread, so
+    // these programs are much larger; recovery from the junk statements
+    // may cross the points where the input is cut
+    int large = programs / 100 + 2;
+    for (int i = 0; i < large; i++) {
+        Program program = generate_program(30000);
+        ParseResult expected = parse_source(program.text, 0);
+        for (int threads = 2; threads <= 8; threads *= 2) {
+            check_parallel(&program, i, &expected, threads);
+        }
+        check_pipelined(&program, programs + i, &expected);
+        free_parse_result(&expected);
+        free(program.text);
+    }
+
+    printf("%d programs and %d large programs checked, %d failed\n", programs, large, failures);
+    return failures != 0;
+}
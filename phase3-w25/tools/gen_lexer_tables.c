@@ -0,0 +1,222 @@
+/* gen_lexer_tables.c */
+// Generates src/lexer/lexer_tables.h: a collision-free hash table for the
+// keywords and a state-transition table for the operators/punctuators.
+// The token sets below are the single source of truth; after changing
+// them, rebuild and rerun:
+//
+//   gcc -o gen_lexer_tables tools/gen_lexer_tables.c
+//   ./gen_lexer_tables > src/lexer/lexer_tables.h
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Keywords table
+static const struct {
+    const char* word;
+    const char* type;
+} keywords[] = {
+    {"if", "TOKEN_IF"},
+    {"while", "TOKEN_WHILE"},
+    {"factorial", "TOKEN_FACT"},
+    {"int", "TOKEN_INT"},
+    {"print", "TOKEN_PRINT"},
+    {"repeat", "TOKEN_REPEAT"},
+    {"until", "TOKEN_UNTIL"}
+};
+
+// Operators and punctuators. The lexer takes the longest match.
+static const struct {
+    const char* text;
+    const char* type;
+    const char* kind;
+} operators[] = {
+    {"+", "TOKEN_OPERATOR", "OP_ADD"},
+    {"-", "TOKEN_OPERATOR", "OP_SUB"},
+    {"*", "TOKEN_OPERATOR", "OP_MUL"},
+    {"/", "TOKEN_OPERATOR", "OP_DIV"},
+    {"=", "TOKEN_EQUALS", "OP_NONE"},
+    {"==", "TOKEN_COMPARE", "OP_EQ"},
+    {"<", "TOKEN_COMPARE", "OP_LT"},
+    {"<=", "TOKEN_COMPARE", "OP_LE"},
+    {">", "TOKEN_COMPARE", "OP_GT"},
+    {">=", "TOKEN_COMPARE", "OP_GE"},
+    {";", "TOKEN_SEMICOLON", "OP_NONE"},
+    {"(", "TOKEN_LPAREN", "OP_NONE"},
+    {")", "TOKEN_RPAREN", "OP_NONE"},
+    {"{", "TOKEN_LBRACE", "OP_NONE"},
+    {"}", "TOKEN_RBRACE", "OP_NONE"}
+};
+
+#define KEYWORD_COUNT (int)(sizeof(keywords) / sizeof(keywords[0]))
+#define OPERATOR_COUNT (int)(sizeof(operators) / sizeof(operators[0]))
+#define MAX_STATES 64
+#define MAX_CLASSES 64
+
+// The keyword hash. The search below computes it with this macro, and the
+// same text is written into the header as KEYWORD_HASH(), which is what
+// is_keyword() in lexer.c calls, so the two cannot drift apart.
+#define KEYWORD_HASH_FORMULA(word, length, mul_first, mul_last, mask) \
+    (((unsigned char)(word)[0] * (mul_first) + \
+      (unsigned char)(word)[(length) - 1] * (mul_last) + (unsigned)(length)) & (mask))
+#define EXPANDED_TEXT(x) #x
+#define TEXT_OF(x) EXPANDED_TEXT(x)
+
+static unsigned keyword_hash(const char* word, int length, unsigned mul_first,
+                             unsigned mul_last, unsigned mask) {
+    return KEYWORD_HASH_FORMULA(word, length, mul_first, mul_last, mask);
+}
+
+static void generate_keyword_table(void) {
+    int min_length = 1000, max_length = 0;
+    for (int i = 0; i < KEYWORD_COUNT; i++) {
+        int length = (int)strlen(keywords[i].word);
+        if (length < min_length) min_length = length;
+        if (length > max_length) max_length = length;
+    }
+
+    // Search for the smallest power-of-two table and multipliers that put
+    // every keyword in its own slot
+    for (unsigned size = 8; size <= 1024; size *= 2) {
+        for (unsigned mul_first = 1; mul_first < 256; mul_first++) {
+            for (unsigned mul_last = 1; mul_last < 256; mul_last++) {
+                int slot_of[1024];
+                int used[1024] = {0};
+                int ok = 1;
+                for (int i = 0; i < KEYWORD_COUNT && ok; i++) {
+                    const char* word = keywords[i].word;
+                    unsigned h = keyword_hash(word, (int)strlen(word), mul_first, mul_last, size - 1);
+                    if (used[h]) {
+                        ok = 0;
+                    }
+                    used[h] = 1;
+                    slot_of[h] = i;
+                }
+                if (!ok) {
+                    continue;
+                }
+
+                printf("// Keyword perfect hash: slot = (first * %u + last * %u + length) & %u\n",
+                       mul_first, mul_last, size - 1);
+                printf("#define KEYWORD_HASH_SIZE %u\n", size);
+                printf("#define KEYWORD_HASH_MUL_FIRST %u\n", mul_first);
+                printf("#define KEYWORD_HASH_MUL_LAST %u\n", mul_last);
+                printf("#define KEYWORD_MIN_LENGTH %d\n", min_length);
+                printf("#define KEYWORD_MAX_LENGTH %d\n", max_length);
+                printf("#define KEYWORD_HASH(word, length) %s\n\n",
+                       TEXT_OF(KEYWORD_HASH_FORMULA(word, length, KEYWORD_HASH_MUL_FIRST,
+                                                    KEYWORD_HASH_MUL_LAST, KEYWORD_HASH_SIZE - 1)));
+                printf("static const struct {\n");
+                printf("    const char* word;\n");
+                printf("    int length;\n");
+                printf("    TokenType type;\n");
+                printf("} keyword_table[KEYWORD_HASH_SIZE] = {\n");
+                for (unsigned h = 0; h < size; h++) {
+                    if (used[h]) {
+                        const char* word = keywords[slot_of[h]].word;
+                        printf("    {\"%s\", %d, %s},\n", word, (int)strlen(word), keywords[slot_of[h]].type);
+                    } else {
+                        printf("    {\"\", 0, TOKEN_ERROR},\n");
+                    }
+                }
+                printf("};\n\n");
+                return;
+            }
+        }
+    }
+    fprintf(stderr, "gen_lexer_tables: no collision-free keyword hash found\n");
+    exit(1);
+}
+
+static void generate_operator_dfa(void) {
+    // Character classes: every byte used by an operator gets its own class,
+    // everything else is class 0
+    int char_class[256] = {0};
+    int class_count = 1;
+    for (int i = 0; i < OPERATOR_COUNT; i++) {
+        for (const char* c = operators[i].text; *c; c++) {
+            if (!char_class[(unsigned char)*c]) {
+                char_class[(unsigned char)*c] = class_count++;
+            }
+        }
+    }
+    if (class_count > MAX_CLASSES) {
+        fprintf(stderr, "gen_lexer_tables: too many operator characters\n");
+        exit(1);
+    }
+
+    // Build the DFA as a trie of the operator texts. State 0 is the dead
+    // state and state 1 the start state.
+    int transition[MAX_STATES][MAX_CLASSES] = {{0}};
+    const char* accept[MAX_STATES];
+    const char* kind[MAX_STATES];
+    int state_count = 2;
+    for (int s = 0; s < MAX_STATES; s++) {
+        accept[s] = "TOKEN_ERROR";
+        kind[s] = "OP_NONE";
+    }
+    for (int i = 0; i < OPERATOR_COUNT; i++) {
+        int state = 1;
+        for (const char* c = operators[i].text; *c; c++) {
+            int cls = char_class[(unsigned char)*c];
+            if (!transition[state][cls]) {
+                if (state_count == MAX_STATES) {
+                    fprintf(stderr, "gen_lexer_tables: too many DFA states\n");
+                    exit(1);
+                }
+                transition[state][cls] = state_count++;
+            }
+            state = transition[state][cls];
+        }
+        accept[state] = operators[i].type;
+        kind[state] = operators[i].kind;
+    }
+
+    printf("// Operator DFA: op_transition[state][op_char_class[c]] gives the next\n");
+    printf("// state (OP_STATE_DEAD stops the match), op_accept[state] the token\n");
+    printf("// type recognized so far (TOKEN_ERROR if none) and op_kind[state] its\n");
+    printf("// operator kind.\n");
+    printf("#define OP_CLASS_COUNT %d\n", class_count);
+    printf("#define OP_STATE_COUNT %d\n", state_count);
+    printf("#define OP_STATE_DEAD 0\n");
+    printf("#define OP_STATE_START 1\n\n");
+
+    printf("static const unsigned char op_char_class[256] = {");
+    for (int c = 0; c < 256; c++) {
+        printf("%s%d,", c % 16 ? " " : "\n    ", char_class[c]);
+    }
+    printf("\n};\n\n");
+
+    printf("static const unsigned char op_transition[OP_STATE_COUNT][OP_CLASS_COUNT] = {\n");
+    for (int s = 0; s < state_count; s++) {
+        printf("    {");
+        for (int cls = 0; cls < class_count; cls++) {
+            printf("%s%d", cls ? ", " : "", transition[s][cls]);
+        }
+        printf("},\n");
+    }
+    printf("};\n\n");
+
+    printf("static const TokenType op_accept[OP_STATE_COUNT] = {\n");
+    for (int s = 0; s < state_count; s++) {
+        printf("    %s,\n", accept[s]);
+    }
+    printf("};\n\n");
+
+    printf("static const OperatorKind op_kind[OP_STATE_COUNT] = {\n");
+    for (int s = 0; s < state_count; s++) {
+        printf("    %s,\n", kind[s]);
+    }
+    printf("};\n\n");
+}
+
+int main(void) {
+    printf("/* lexer_tables.h */\n");
+    printf("// Generated by tools/gen_lexer_tables.c -- do not edit by hand.\n");
+    printf("#ifndef LEXER_TABLES_H\n");
+    printf("#define LEXER_TABLES_H\n\n");
+    printf("#include \"../../include/tokens.h\"\n\n");
+    generate_keyword_table();
+    generate_operator_dfa();
+    printf("#endif /* LEXER_TABLES_H */\n");
+    return 0;
+}